@@ -0,0 +1,17 @@
+#ifndef ORCA_ASM_H
+#define ORCA_ASM_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+
+#define ASM_MAX_SIZE (MEMORY_SIZE - PRG_ADDR)
+
+typedef struct {
+    uint8_t code[ASM_MAX_SIZE];
+    int size;
+    int error_line; // 1-based, 0 when assembly succeeded
+    char error[128];
+} asm_result;
+
+bool assemble(const char *source, asm_result *out);
+#endif //ORCA_ASM_H
@@ -0,0 +1,31 @@
+#ifndef ORCA_BOOTCACHE_H
+#define ORCA_BOOTCACHE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+#include <sha1.h>
+
+#define BOOT_CACHE_DIR "orca-boot"
+// bump whenever chip_8 or anything that decides the boot sequence changes meaning
+#define BOOT_CACHE_VERSION 3
+// a prefix never skips more than this much emulated time
+#define BOOT_MAX_FRAMES 600
+
+// what a cached state is valid for; a file whose header doesn't match is ignored
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t state_size;
+    uint8_t sha1[SHA1_SIZE];
+    uint8_t profile;
+    uint8_t reserved[3];
+    uint32_t steps_per_frame;
+    uint32_t frames; // input-free prefix length
+} boot_header;
+
+long boot_prefix(chip_8 *c, int steps_per_frame, long max_frames);
+bool boot_cache_load(const char *dir, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, chip_8 *c, long *frames);
+bool boot_cache_store(const char *dir, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, const chip_8 *c,
+                      long frames);
+long boot_skip(chip_8 *c, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, const char *dir, bool *cached);
+#endif //ORCA_BOOTCACHE_H
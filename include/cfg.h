@@ -0,0 +1,77 @@
+#ifndef ORCA_CFG_H
+#define ORCA_CFG_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+
+#define CFG_MAX_BLOCKS 1024
+#define CFG_MAX_CALLS 512
+#define CFG_MAX_SITES 64
+#define CFG_NO_BLOCK 0xffff
+
+// what static analysis says about each byte of memory
+enum {
+    CFG_CODE = 1 << 0,        // an instruction starts here
+    CFG_OPERAND = 1 << 1,     // second byte of an instruction
+    CFG_DATA = 1 << 2,        // read through I: sprites, FX65 tables
+    CFG_LEADER = 1 << 3,      // a basic block starts here
+    CFG_CALL_TARGET = 1 << 4, // a subroutine starts here
+    CFG_LOOP_HEAD = 1 << 5,   // the target of a loop's back edge
+    CFG_WRITTEN = 1 << 6,     // FX33/FX55 write here with I known
+};
+
+// how a basic block ends
+typedef enum {
+    BLOCK_FALLS,    // runs into the next block
+    BLOCK_JUMPS,    // 1NNN
+    BLOCK_BRANCHES, // a skip: the next instruction or the one after it
+    BLOCK_CALLS,    // 2NNN, returning to the next block
+    BLOCK_RETURNS,  // 00EE
+    BLOCK_INDIRECT, // BNNN, the target depends on a register
+    BLOCK_HALTS,    // jumps to itself
+    BLOCK_TRAPS,    // an illegal opcode or the end of memory
+} block_end;
+
+typedef struct {
+    uint16_t start; // [start, end)
+    uint16_t end;
+    uint16_t succ[2];
+    uint8_t succ_count;
+    uint8_t kind;       // block_end
+    uint8_t loop_depth; // loops the block is part of
+    bool idle;          // in a loop that only polls timers and keys, skipping and jumping
+} cfg_block;
+
+typedef struct {
+    uint16_t site;
+    uint16_t target;
+} cfg_edge;
+
+// the control flow of a ROM, recovered by recursive descent from the entry point
+// without running it. code reached only through BNNN, or written at run time,
+// stays unknown.
+typedef struct {
+    uint8_t flags[MEMORY_SIZE];
+    uint16_t block_of[MEMORY_SIZE]; // index of the block holding each instruction, or CFG_NO_BLOCK
+    cfg_block blocks[CFG_MAX_BLOCKS];
+    int block_count;
+    cfg_edge calls[CFG_MAX_CALLS]; // call graph: the 2NNN at site calls target
+    int call_count;
+    uint16_t indirect[CFG_MAX_SITES]; // BNNN sites
+    int indirect_count;
+    cfg_edge self_mod[CFG_MAX_SITES]; // FX33/FX55 at site writes over code at target
+    int self_mod_count;
+    int loops; // back edges, each with its natural loop
+    int idle_loops;
+    int code_bytes;
+    int data_bytes;
+    bool truncated; // more blocks, calls or sites than fit
+} cfg;
+
+void cfg_build(cfg *g, const chip_8 *c);
+
+static inline const cfg_block *cfg_block_at(const cfg *g, uint16_t addr) {
+    uint16_t b = addr < MEMORY_SIZE ? g->block_of[addr] : CFG_NO_BLOCK;
+    return b == CFG_NO_BLOCK ? NULL : &g->blocks[b];
+}
+#endif //ORCA_CFG_H
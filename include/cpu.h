@@ -0,0 +1,34 @@
+#ifndef ORCA_CPU_H
+#define ORCA_CPU_H
+#include <main.h>
+#include <debug.h>
+#include <quirks.h>
+chip_8 *chip_alloc(void);
+void init(chip_8 *c);
+void step(chip_8 *c);
+bool load(chip_8 *c, const char *filename);
+bool load_buffer(chip_8 *c, const uint8_t *data, long size);
+void raise_trap(chip_8 *c, trap_kind kind);
+const char *trap_name(trap_kind kind);
+void set_watchdog(chip_8 *c, uint64_t instructions);
+void tick_timers(chip_8 *c);
+void set_keys(chip_8 *c, uint16_t keys);
+void begin_frame(chip_8 *c, uint16_t keys);
+int run_steps(chip_8 *c, int n, debugger *dbg, uint32_t *idle);
+int run_frame(chip_8 *c, uint16_t keys);
+
+// the instruction at addr, or 0 if it would straddle the end of memory
+static inline uint16_t opcode_at(const chip_8 *c, uint16_t addr) {
+    return addr < MEMORY_SIZE - 1 ? (c->memory[addr] << 8) | c->memory[addr + 1] : 0;
+}
+
+// the machine is blocked in FX0A: no key has been released since the keys last changed.
+// keys never change within one run_steps() call; begin_frame() and input_run_frame()
+// change them between calls. until then every instruction it runs is the same FX0A
+// spin, so run_steps() takes them all at once and schedule_steps() skips it.
+static inline bool waiting_for_key(const chip_8 *c) {
+    return c->running && (opcode_at(c, c->pc) & 0xf0ff) == 0xf00a && !(c->keyold & ~c->keycur);
+}
+
+int schedule_steps(chip_8 *c, int n);
+#endif //ORCA_CPU_H
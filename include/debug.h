@@ -0,0 +1,72 @@
+#ifndef ORCA_DEBUG_H
+#define ORCA_DEBUG_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+
+#define MAX_CONDITIONS 8
+#define MAX_WATCHPOINTS 8
+// a condition with this pc fires wherever the program is
+#define ANY_PC 0xffff
+
+typedef enum {
+    COND_EQ,
+    COND_NE,
+    COND_LT,
+    COND_GT
+} cond_op;
+
+typedef struct {
+    uint16_t pc;
+    uint8_t reg;
+    uint8_t op;
+    uint8_t value;
+} reg_condition;
+
+// write watchpoint over [start, end)
+typedef struct {
+    uint16_t start;
+    uint16_t end;
+} watch_range;
+
+typedef enum {
+    HIT_NONE,
+    HIT_BREAKPOINT,
+    HIT_CONDITION,
+    HIT_WATCHPOINT
+} hit_kind;
+
+typedef struct {
+    uint64_t breakpoints[MEMORY_SIZE / 64]; // one bit per address
+    int breakpoint_count;
+    reg_condition conditions[MAX_CONDITIONS];
+    int condition_count;
+    watch_range watches[MAX_WATCHPOINTS];
+    int watch_count;
+    // non-zero whenever anything above is set; the engine only switches to the
+    // debug instantiation of the batch loop while this is non-zero.
+    int armed;
+
+    hit_kind hit;
+    uint16_t hit_pc;   // instruction that caused the stop
+    uint16_t hit_addr; // first watched byte written, for HIT_WATCHPOINT
+} debugger;
+
+void debug_reset(debugger *d);
+void debug_toggle_breakpoint(debugger *d, uint16_t addr);
+bool debug_add_condition(debugger *d, uint16_t pc, uint8_t reg, cond_op op, uint8_t value);
+bool debug_add_watch(debugger *d, uint16_t start, uint16_t end);
+bool debug_toggle_watch(debugger *d, uint16_t start, uint16_t end);
+void debug_clear_conditions(debugger *d);
+void debug_clear_watches(debugger *d);
+hit_kind debug_match_before(const debugger *d, const chip_8 *c);
+bool debug_write_span(uint16_t op, uint16_t I, uint16_t *lo, uint16_t *hi);
+int debug_match_write(const debugger *d, uint16_t lo, uint16_t hi);
+bool debug_check_before(debugger *d, const chip_8 *c, bool resuming);
+bool debug_check_after(debugger *d, uint16_t pc, uint16_t op, uint16_t I);
+const char *debug_hit_name(hit_kind kind);
+
+static inline bool debug_has_breakpoint(const debugger *d, uint16_t addr) {
+    return (d->breakpoints[(addr & 0xfff) >> 6] >> (addr & 63)) & 1;
+}
+#endif //ORCA_DEBUG_H
@@ -0,0 +1,52 @@
+#ifndef ORCA_DEBUGVIEW_H
+#define ORCA_DEBUGVIEW_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+#include <debug.h>
+#include <cfg.h>
+#include <raylib.h>
+
+#define DEBUG_ROWS 14
+#define MEM_ROW_BYTES 8
+
+// rows are only re-rendered to text when what they show changes
+typedef struct {
+    bool valid;
+    uint16_t addr;
+    uint16_t op;
+    uint8_t flags; // what the control-flow analysis says about addr
+    uint8_t profile; // BNNN reads differently per profile
+    char text[32];
+} disasm_row;
+
+typedef struct {
+    bool valid;
+    uint16_t addr;
+    uint8_t bytes[MEM_ROW_BYTES];
+    char text[40];
+} mem_row;
+
+// requests the view hands back to the main loop, which owns the history
+typedef enum {
+    DEBUG_ACTION_NONE,
+    DEBUG_ACTION_REVERSE_CONTINUE,
+    DEBUG_ACTION_LAST_WRITE
+} debug_action;
+
+typedef struct {
+    disasm_row code[DEBUG_ROWS];
+    mem_row mem[DEBUG_ROWS];
+    uint16_t code_top;
+    uint16_t mem_top;
+    bool follow_pc;
+    int reformatted; // rows re-rendered during the last frame
+    const cfg *flow; // static analysis of the loaded ROM, if any: tells code from data
+    uint16_t query_start; // range for DEBUG_ACTION_LAST_WRITE
+    uint16_t query_end;
+    char message[64];
+} debug_view;
+
+void debug_view_init(debug_view *v);
+debug_action draw_debug_view(debug_view *v, const chip_8 *c, debugger *d, Rectangle bounds);
+#endif //ORCA_DEBUGVIEW_H
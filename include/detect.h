@@ -0,0 +1,37 @@
+#ifndef ORCA_DETECT_H
+#define ORCA_DETECT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+#include <sha1.h>
+
+// frames each profile runs for during detection (one minute of emulated time)
+#define DETECT_FRAMES 3600
+// per-ROM profile database, one "sha1 profile name" line per ROM
+#define DETECT_DB "orca-quirks.db"
+
+typedef struct {
+    uint8_t trap;       // trap_kind the run ended with, TRAP_NONE if it lasted all frames
+    long trap_frame;
+    bool stalled;       // the screen stopped changing for the second half while others didn't
+    uint64_t last_hash; // framebuffer hash after the final frame
+    int hint;           // static evidence for this profile, see detect_hints()
+    int score;
+} profile_run;
+
+typedef struct {
+    profile_run runs[PROFILE_COUNT];
+    long diverged_frame; // first frame where any two profiles showed different screens, -1 if none did
+    quirk_profile best;
+    quirk_profile platform; // newest instruction set among the executed instructions
+    bool agnostic;       // every profile behaved identically and nothing in the code prefers one
+} detect_result;
+
+void detect_hints(const uint8_t *rom, long size, const uint64_t *executed, int hints[PROFILE_COUNT]);
+uint16_t detect_keys(long frame);
+bool detect_profile(const uint8_t *rom, long size, long frames, detect_result *out);
+
+bool quirkdb_lookup(const char *db, const char *hex, quirk_profile *out);
+bool quirkdb_store(const char *db, const char *hex, quirk_profile profile, const char *name);
+bool rom_sha1_file(const char *path, uint8_t digest[SHA1_SIZE]);
+#endif //ORCA_DETECT_H
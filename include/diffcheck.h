@@ -0,0 +1,45 @@
+#ifndef ORCA_DIFFCHECK_H
+#define ORCA_DIFFCHECK_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+
+// instructions between state comparisons unless asked otherwise. the machines are
+// compared when the candidate next returns, so 1 compares after every call
+#define DIFF_INTERVAL 64
+
+// an execution engine: run up to n instructions with the machine's own profile and
+// return how many ran, stopping early only if the machine stops. engines[0] is
+// the reference, plain step() in a loop; every faster path is registered after it.
+typedef struct {
+    const char *name;
+    int (*run)(chip_8 *c, int n);
+    const char *about;
+} engine;
+
+extern const engine engines[];
+extern const int engine_count;
+// a deliberately broken engine, for checking that the checker catches a faulty
+// superinstruction
+extern const engine diff_planted;
+
+// one ROM and input to check an engine on
+typedef struct {
+    char name[64];
+    chip_8 start;
+    uint16_t *keys; // keys held in each frame
+    uint32_t frames;
+    int steps_per_frame;
+    // filled in by the check
+    bool diverged;
+    uint64_t instructions; // run by each engine, or up to the divergence
+    uint16_t pc;           // the first instruction, or superinstruction, the engines disagree on
+    uint16_t op;
+    char report[512];
+} diff_job;
+
+const engine *engine_find(const char *name);
+bool diff_run(const engine *candidate, diff_job *job, int interval);
+int diff_batch(const engine *candidate, diff_job *jobs, int count, int interval, int threads);
+int diff_format(const chip_8 *expected, const chip_8 *actual, char *out, int size);
+#endif //ORCA_DIFFCHECK_H
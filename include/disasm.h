@@ -0,0 +1,7 @@
+#ifndef ORCA_DISASM_H
+#define ORCA_DISASM_H
+#include <stddef.h>
+#include <stdint.h>
+#include <quirks.h>
+void disasm(uint16_t op, quirks q, char *buf, size_t size);
+#endif //ORCA_DISASM_H
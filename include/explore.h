@@ -0,0 +1,70 @@
+#ifndef ORCA_EXPLORE_H
+#define ORCA_EXPLORE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <main.h>
+
+#define EXPLORE_MAX_DEPTH 256
+// a choice is "no keys" or one of the 16 keys
+#define EXPLORE_ACTIONS 17
+#define EXPLORE_MAX_TRAPS 8
+
+typedef enum {
+    GOAL_NONE,   // explore everything, collecting traps and dead ends
+    GOAL_TRAP,   // stop at the first trap
+    GOAL_MEMORY, // memory[addr] == value
+    GOAL_PIXEL,  // pixel (x, y) lit
+    GOAL_PC,     // about to execute addr
+} goal_kind;
+
+typedef struct {
+    goal_kind kind;
+    uint16_t addr;
+    uint8_t value;
+    uint8_t x;
+    uint8_t y;
+} explore_goal;
+
+typedef struct {
+    int depth;           // choices deep, at most EXPLORE_MAX_DEPTH
+    int beam;            // states kept per layer; the rest of a layer is dropped
+    int hold;            // frames each choice is held for
+    int steps_per_frame;
+    int threads;
+    uint16_t keys;       // keys tried besides "no keys"
+    uint32_t max_states; // distinct states remembered for deduplication
+    explore_goal goal;
+} explore_params;
+
+// a way there from the start: path[i] is 0 for no keys or key + 1, each held `hold` frames
+typedef struct {
+    int length;
+    uint8_t path[EXPLORE_MAX_DEPTH];
+} explore_path;
+
+typedef struct {
+    uint8_t trap;
+    uint16_t pc;
+    uint16_t op;
+    explore_path how;
+} explore_trap;
+
+typedef struct {
+    uint64_t frames;    // emulated frames, including re-simulation
+    uint64_t children;  // states produced
+    uint64_t unique;    // distinct ones
+    int layers;
+    double seconds;
+    bool goal_found;
+    explore_path goal;
+    int trap_count;     // distinct (kind, pc) traps
+    explore_trap traps[EXPLORE_MAX_TRAPS];
+    uint64_t dead_ends; // states no input could change
+    explore_path dead_end;
+} explore_result;
+
+void explore_defaults(explore_params *p);
+bool explore(const chip_8 *start, const explore_params *p, explore_result *r);
+bool goal_parse(const char *text, explore_goal *goal);
+void explore_path_format(const explore_path *path, char *out, int size);
+#endif //ORCA_EXPLORE_H
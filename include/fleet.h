@@ -0,0 +1,39 @@
+#ifndef ORCA_FLEET_H
+#define ORCA_FLEET_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <main.h>
+
+// a parked machine: everything but its memory, which is the fleet's shared image
+// except for the pages it has written
+typedef struct {
+    uint8_t hot[CHIP_8_LINE];
+    uint8_t display[SCREEN_WIDTH][SCREEN_HEIGHT];
+    uint8_t cold[sizeof(chip_8) - offsetof(chip_8, memory_hash)];
+    uint8_t *page[MEMORY_PAGES]; // a private copy, or NULL while the page is shared
+} fleet_machine;
+
+// many machines started from the same state. the memory they all start with is kept
+// once, read only; a machine gets its own copy of a page the first time FX33 or FX55
+// writes into it. machines run one at a time in a working machine, and a page is only
+// copied in when the one already there came from somewhere else, so machines that
+// never write memory never copy it.
+typedef struct {
+    uint8_t *image; // the starting memory
+    fleet_machine *machines;
+    int count;
+    chip_8 *work;
+    int current; // the machine in `work`, or -1
+    const uint8_t *loaded[MEMORY_PAGES]; // where each page in work->memory came from
+    size_t private_pages;
+} fleet;
+
+bool fleet_init(fleet *f, const chip_8 *start, int count);
+void fleet_free(fleet *f);
+chip_8 *fleet_enter(fleet *f, int i);
+void fleet_leave(fleet *f);
+int fleet_run_frame(fleet *f, int i, uint16_t keys, int steps);
+bool fleet_running(const fleet *f, int i);
+size_t fleet_memory(const fleet *f);
+#endif //ORCA_FLEET_H
@@ -0,0 +1,34 @@
+#ifndef ORCA_FUZZ_H
+#define ORCA_FUZZ_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <main.h>
+
+// frames each input runs for, so no input takes more than FUZZ_FRAMES * STEPS_PER_FRAME
+// instructions
+#define FUZZ_FRAMES 120
+// a key script longer than this wraps the length byte around
+#define FUZZ_MAX_SCRIPT 64
+#define FUZZ_HEADER 2
+
+// a fuzz input is
+//   byte 0       quirk profile, modulo PROFILE_COUNT
+//   byte 1       n, the key script length in frames, modulo FUZZ_MAX_SCRIPT
+//   2n bytes     the keys held in each frame, little-endian; frame f uses entry f % n
+//   the rest     the ROM, loaded at PRG_ADDR and cut at the end of memory
+// a short input just gets a shorter script or ROM: every byte string is valid.
+
+typedef struct {
+    trap_kind trap;
+    uint64_t cycles;
+    bool hash_ok; // the incremental state hashes agree with a full recompute
+} fuzz_outcome;
+
+void fuzz_template(chip_8 *template);
+const uint8_t *fuzz_load(const chip_8 *template, chip_8 *c, const uint8_t *data, size_t size, int *length);
+uint16_t fuzz_keys(const uint8_t *script, int length, uint32_t frame);
+void fuzz_mutate(uint8_t *input, size_t size, uint32_t *rng);
+void fuzz_one(const chip_8 *template, chip_8 *c, const uint8_t *data, size_t size, fuzz_outcome *out);
+size_t fuzz_input(const uint8_t *rom, size_t rom_size, quirk_profile profile, uint8_t *out, size_t capacity);
+#endif //ORCA_FUZZ_H
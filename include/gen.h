@@ -0,0 +1,31 @@
+#ifndef ORCA_GEN_H
+#define ORCA_GEN_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <asm.h>
+
+// synthetic workloads, each stressing one path of the interpreter
+typedef enum {
+    GEN_ALU,       // tight 7XNN/8XYN loops, no drawing
+    GEN_DRAW,      // DXYN with tall sprites walking over the screen edges
+    GEN_CALLS,     // 2NNN/00EE chains as deep as the stack allows
+    GEN_BULK,      // FX55/FX65 bulk register copies
+    GEN_SELFMOD,   // code that patches the instruction it executes next
+    GEN_COUNT
+} gen_kind;
+
+typedef struct {
+    gen_kind kind;
+    int unroll; // repeated body instructions per loop iteration
+    int height; // sprite height for GEN_DRAW (1-15)
+    int depth;  // call depth for GEN_CALLS, clamped to STACK_SIZE
+    int regs;   // highest register copied by GEN_BULK (0-15)
+    unsigned seed;
+} gen_params;
+
+void gen_defaults(gen_kind kind, gen_params *p);
+const char *gen_kind_name(gen_kind kind);
+bool gen_kind_parse(const char *name, gen_kind *kind);
+bool gen_source(const gen_params *p, char *buf, size_t size);
+bool gen_rom(const gen_params *p, asm_result *out);
+#endif //ORCA_GEN_H
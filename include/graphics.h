@@ -1,6 +1,9 @@
 #ifndef ORCA_GRAPHICS_H
 #define ORCA_GRAPHICS_H
 #include <main.h>
+#include <perf.h>
+#include <raylib.h>
 void clear_display_ray();
-void draw_sprite_ray(chip_8 *c);
+void draw_sprite_ray(const chip_8 *c);
+void draw_perf_hud(const perf_stats *s, Rectangle bounds, size_t footprint);
 #endif //ORCA_GRAPHICS_H
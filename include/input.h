@@ -0,0 +1,41 @@
+#ifndef ORCA_INPUT_H
+#define ORCA_INPUT_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <main.h>
+#include <debug.h>
+#include <rewind.h>
+
+#define INPUT_QUEUE_SIZE 64
+
+// the keys held from instruction `step` of frame `frame` on. frames count from when
+// the machine started; an event with step 0 is latched at the frame boundary exactly
+// as begin_frame() would.
+typedef struct {
+    uint32_t frame;
+    uint16_t step;
+    uint16_t keys;
+} key_event;
+
+// key events waiting for the frame they belong to, oldest first
+typedef struct {
+    key_event events[INPUT_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} input_queue;
+
+// what a recording was made with, which a replay needs to reproduce it. it is the
+// first line of the file: "orca-input <profile> <steps per frame>"
+typedef struct {
+    quirk_profile profile;
+    int steps_per_frame;
+} input_header;
+
+bool input_push(input_queue *q, key_event e);
+int input_run_frame(chip_8 *c, input_queue *q, uint32_t frame, int steps, debugger *dbg, uint32_t *idle,
+                    rewind_log *r);
+void input_write_header(FILE *fp, input_header h);
+void input_write(FILE *fp, key_event e);
+key_event *input_read(FILE *fp, input_header *h, uint32_t *count);
+#endif //ORCA_INPUT_H
@@ -0,0 +1,56 @@
+#ifndef ORCA_LIBRARY_H
+#define ORCA_LIBRARY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <main.h>
+#include <sha1.h>
+
+#define LIBRARY_CATALOGUE "orca-library.cat"
+#define LIBRARY_VERSION 1
+// frames each ROM runs for during a scan; the thumbnail is the screen after the last one
+#define LIBRARY_FRAMES 600
+#define LIBRARY_PATH_SIZE 256
+#define THUMB_BYTES (SCREEN_WIDTH * SCREEN_HEIGHT / 8)
+
+// one ROM, fixed size so the catalogue can be used straight from the mapping
+typedef struct {
+    uint8_t sha1[SHA1_SIZE];
+    uint16_t size;
+    uint8_t platform; // newest instruction set the code uses, as a quirk_profile
+    uint8_t profile;  // quirks picked by detect_profile()
+    uint32_t ips;     // preferred instructions per second for the platform
+    uint8_t trap;     // trap_kind the thumbnail run ended with
+    uint8_t reserved[3];
+    uint8_t thumb[THUMB_BYTES]; // row-major, one bit per pixel, msb first
+    char path[LIBRARY_PATH_SIZE];
+} library_entry;
+
+// the file is this header followed by `count` entries sorted by sha1
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t entry_size;
+    uint32_t reserved;
+} library_header;
+
+typedef struct {
+    void *map;
+    size_t map_size;
+    const library_entry *entries;
+    uint32_t count;
+} library;
+
+bool library_open(library *lib, const char *path);
+void library_close(library *lib);
+const library_entry *library_find(const library *lib, const uint8_t sha1[SHA1_SIZE]);
+bool library_scan(const char *dir, const char *catalogue, int threads, long frames);
+uint32_t platform_ips(uint8_t platform);
+const char *library_name(const library_entry *e);
+
+static inline bool thumb_pixel(const library_entry *e, int x, int y) {
+    int bit = y * SCREEN_WIDTH + x;
+    return (e->thumb[bit / 8] >> (7 - bit % 8)) & 1;
+}
+#endif //ORCA_LIBRARY_H
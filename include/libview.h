@@ -0,0 +1,23 @@
+#ifndef ORCA_LIBVIEW_H
+#define ORCA_LIBVIEW_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <library.h>
+#include <raylib.h>
+
+#define LIBRARY_ROWS 6
+
+// only the visible rows have thumbnail textures; a row's texture is re-uploaded
+// only when scrolling puts a different ROM in it
+typedef struct {
+    const library *lib;
+    uint32_t top;
+    int64_t shown[LIBRARY_ROWS]; // entry index in each row's texture, -1 if none
+    Texture2D thumbs[LIBRARY_ROWS];
+    int uploaded; // thumbnails uploaded during the last frame
+} library_view;
+
+void library_view_init(library_view *v, const library *lib);
+void library_view_free(library_view *v);
+const library_entry *draw_library_view(library_view *v, Rectangle bounds);
+#endif //ORCA_LIBVIEW_H
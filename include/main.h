@@ -1,5 +1,7 @@
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <quirks.h>
 
 #ifndef ORCA_MAIN_H
 
@@ -10,7 +12,14 @@
 #define SCREEN_HEIGHT 32
 // chip-8 config
 #define MEMORY_SIZE 4096
+// granularity of chip_8.written and of the pages fleet machines share
+#define MEMORY_PAGE 256
+#define MEMORY_PAGES (MEMORY_SIZE / MEMORY_PAGE)
 #define STACK_SIZE 12
+// instructions executed per 60 Hz frame
+#define STEPS_PER_FRAME 9
+// initial CXNN generator state; fixed so every boot of a ROM behaves the same
+#define RNG_SEED 0x2545f491u
 
 // graphical settings
 #define GFX_SCALE 10
@@ -19,6 +28,18 @@
 // #define ON_COLOR
 // #define OFF_COLOR
 
+// why a machine stopped by itself. a trap only clears `running`, so the run loops
+// stop without any extra check; the rest of the process keeps going.
+typedef enum {
+    TRAP_NONE,
+    TRAP_STACK_OVERFLOW,
+    TRAP_STACK_UNDERFLOW,
+    TRAP_ILLEGAL_OPCODE,
+    TRAP_BAD_ADDRESS, // I or PC would access past the end of memory
+    TRAP_WATCHDOG,
+    TRAP_COUNT
+} trap_kind;
+
 // addresses
 #define PRG_ADDR 0x200
 #define FONT_ADDR 0x050
@@ -42,21 +63,49 @@ static const unsigned char fontset[80] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// laid out by how often the interpreter touches each part: everything one instruction
+// needs in the first 64-byte cache line, then memory and display each starting on a
+// line of their own, then state that only matters when something goes wrong. with
+// thousands of machines running side by side, a step costs one line of registers
+// plus the lines of memory it actually reads.
+#define CHIP_8_LINE 64
+
 typedef struct {
-    uint8_t memory[MEMORY_SIZE];
-    uint8_t display[SCREEN_WIDTH][SCREEN_HEIGHT];
+    // hot: read or written by almost every instruction
     uint16_t pc;
     uint16_t I;
-    uint16_t stack[STACK_SIZE];
     uint8_t sp;
     uint8_t delay_timer;
     uint8_t sound_timer;
-    uint8_t V[16];
-    bool keyold[16];
-    bool keycur[16];
     bool running;
+    uint8_t V[16];
+    uint16_t keycur; // bit k set while key k is held this frame
+    uint16_t keyold; // the same for the previous frame, for FX0A's release test
+    uint32_t rng;    // CXNN generator state, part of the machine so re-execution is deterministic
+    uint64_t cycles; // instructions executed since init()
+    uint16_t stack[STACK_SIZE];
+    // line aligned relative to the start of the machine
+    uint8_t memory[MEMORY_SIZE];
+    uint8_t display[SCREEN_WIDTH][SCREEN_HEIGHT];
+    // cold
+    uint64_t memory_hash;  // kept in step with memory[] by every write, see statehash.h
+    uint64_t display_hash; // same for display[]
+    uint64_t watchdog; // trap once cycles reaches this; 0 disables it
+    uint16_t trap_pc;  // address of the faulting instruction
+    uint16_t trap_op;
+    uint8_t trap;      // trap_kind that stopped the machine
+    uint8_t profile;   // quirk_profile, chosen before the ROM starts
+    uint16_t written;  // a bit per MEMORY_PAGE that FX33/FX55 wrote to, cleared by whoever reads it
 } chip_8;
 
+_Static_assert(offsetof(chip_8, memory) == CHIP_8_LINE, "chip_8 registers must fill exactly one cache line");
+_Static_assert(offsetof(chip_8, display) % CHIP_8_LINE == 0, "chip_8 display must start on a cache line");
+_Static_assert(offsetof(chip_8, memory_hash) % CHIP_8_LINE == 0, "chip_8 cold state must start on a cache line");
+_Static_assert(MEMORY_PAGES <= 16, "chip_8.written has a bit per page");
+
+// bytes to allocate for a machine that starts on a cache line, see chip_alloc()
+#define CHIP_8_ALLOC_SIZE ((sizeof(chip_8) + CHIP_8_LINE - 1) / CHIP_8_LINE * CHIP_8_LINE)
+
 
 #define ORCA_MAIN_H
 
@@ -0,0 +1,66 @@
+#ifndef ORCA_NETPLAY_H
+#define ORCA_NETPLAY_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <main.h>
+
+#define NET_PORT 7458
+// inputs kept per side; a power of two well above twice the window
+#define NET_HISTORY 128
+// how far the local machine may run past the last frame with both inputs known.
+// at the limit it stalls until the peer catches up.
+#define NET_WINDOW 16
+// the confirmed machines are compared every this many frames
+#define NET_HASH_INTERVAL 60
+#define NET_HASHES 8
+
+// each player owns one half of the keypad: 1 2 4 5 7 8 A 0 and 3 C 6 D 9 E B F,
+// so Pong's paddles (1/4 and C/D) land one per player
+#define NET_KEYS_P1 0x05b7
+#define NET_KEYS_P2 0xfa48
+
+// rollback session between two processes. both simulate every frame as soon as
+// their own input is in, guessing that the peer still holds its last known keys.
+// `sync` only ever sees real inputs from both sides; when a guess turns out wrong,
+// `live` is reset to `sync` and the unconfirmed frames are simulated again.
+typedef struct {
+    int sock;
+    struct sockaddr_in peer;
+    int player; // 0 or 1
+    int steps_per_frame;
+    uint32_t tag;      // identifies the ROM and settings, both sides must agree
+    uint32_t frame;    // frames simulated into `live`
+    uint32_t confirmed; // frames simulated into `sync`
+    uint32_t remote_count; // remote inputs received, all contiguous from frame 0
+    uint32_t peer_ack;     // local inputs the peer has received
+    uint16_t local[NET_HISTORY];
+    uint16_t remote[NET_HISTORY];
+    uint16_t predicted[NET_HISTORY]; // remote keys `live` was simulated with
+    chip_8 sync;
+    chip_8 live;
+    // state hashes at multiples of NET_HASH_INTERVAL, [0] ours and [1] the peer's
+    uint32_t hash_frames[2][NET_HASHES];
+    uint64_t hashes[2][NET_HASHES];
+    uint32_t last_hash_sent;
+    long desync_frame; // first frame whose hashes differed, -1 while in sync
+    bool bad_peer;     // the peer is running something else
+    // stats
+    uint32_t rollbacks;
+    uint32_t rollback_frames;
+    uint32_t max_rollback;
+    double max_resim_ms;
+    uint32_t stalls;
+    uint32_t sent;
+    uint32_t received;
+    uint32_t loss_percent; // outgoing packets to drop, for testing
+    uint32_t loss_rng;
+} netplay;
+
+bool netplay_open(netplay *n, int player, uint16_t port, const char *peer);
+void netplay_close(netplay *n);
+void netplay_start(netplay *n, const chip_8 *boot, int steps_per_frame);
+bool netplay_frame(netplay *n, uint16_t keys);
+void netplay_poll(netplay *n);
+uint16_t netplay_mask(int player);
+#endif //ORCA_NETPLAY_H
@@ -19,14 +19,17 @@ void bit_and_reg(chip_8 *c, uint8_t vx, uint8_t vy);
 void bit_xor_reg(chip_8 *c, uint8_t vx, uint8_t vy);
 void add_reg_to_reg(chip_8 *c, uint8_t vx, uint8_t vy);
 void sub_reg(chip_8 *c, uint8_t vx, uint8_t vy);
-void shift_reg_right(chip_8 *c, uint8_t vx, uint8_t vy);
+void shift_reg_right(chip_8 *c, uint8_t vx);
 void sub_reg_rev(chip_8 *c, uint8_t vx, uint8_t vy);
-void shift_reg_left(chip_8 *c, uint8_t vx, uint8_t vy);
+void shift_reg_left(chip_8 *c, uint8_t vx);
 void skip_not_equal_reg(chip_8 *c, uint8_t vx, uint8_t vy);
 void set_index_reg(chip_8 *c, uint16_t value);
-void jmp_addr_V0(chip_8 *c, uint16_t addr);
+void jmp_addr_reg(chip_8 *c, uint16_t addr, uint8_t reg);
 void num_gen(chip_8 *c, uint8_t vx, uint16_t value);
 void draw_sprite(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n);
+void draw_sprite_wrap(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n);
+void draw_sprite_xor(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n);
+void draw_sprite_wrap_xor(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n);
 void skip_if_key_pressed(chip_8 *c, uint8_t vx);
 void skip_if_key_not_pressed(chip_8 *c, uint8_t vx);
 void set_reg_timer(chip_8 *c, uint8_t vx);
@@ -0,0 +1,41 @@
+#ifndef ORCA_PERF_H
+#define ORCA_PERF_H
+#include <stdint.h>
+#include <stddef.h>
+
+// number of frames kept for the HUD, must be a power of two
+#define PERF_SAMPLES 128
+#define PERF_HIST_BUCKETS 16
+// histogram range: bucket i covers [i, i + 1) * PERF_HIST_MS / PERF_HIST_BUCKETS
+#define PERF_HIST_MS 32.0
+
+typedef struct {
+    float frame_ms;  // wall time of the whole host frame
+    float step_ms;   // time spent inside the step() batch
+    float render_ms; // time spent inside draw_sprite_ray()
+    uint32_t steps;  // instructions executed this frame
+    uint32_t idle;   // instructions that left pc unchanged (self-jumps, FX0A spins)
+} perf_sample;
+
+typedef struct {
+    perf_sample samples[PERF_SAMPLES];
+    uint32_t head;
+    uint32_t count;
+} perf_ring;
+
+// summary of the ring, computed on demand by the HUD only
+typedef struct {
+    double ips;         // emulated instructions per wall second
+    double speed;       // emulated time / wall time (1.0 = realtime at 60 Hz)
+    double frame_ms;    // averages over the ring
+    double step_ms;
+    double render_ms;
+    double idle_pct;
+    uint32_t frame_hist[PERF_HIST_BUCKETS];
+    uint32_t render_hist[PERF_HIST_BUCKETS];
+} perf_stats;
+
+double perf_now(void);
+void perf_push(perf_ring *r, const perf_sample *s);
+void perf_summarize(const perf_ring *r, perf_stats *out);
+#endif //ORCA_PERF_H
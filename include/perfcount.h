@@ -0,0 +1,27 @@
+#ifndef ORCA_PERFCOUNT_H
+#define ORCA_PERFCOUNT_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// hardware counters collected by the headless runner (linux perf_event_open only)
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_COUNT
+} counter_id;
+
+typedef struct {
+    int fd[COUNTER_COUNT];
+    uint64_t value[COUNTER_COUNT];
+} perf_counters;
+
+bool counters_open(perf_counters *pc);
+void counters_start(perf_counters *pc);
+void counters_stop(perf_counters *pc);
+void counters_close(perf_counters *pc);
+bool counter_available(const perf_counters *pc, counter_id id);
+const char *counter_name(counter_id id);
+#endif //ORCA_PERFCOUNT_H
@@ -0,0 +1,30 @@
+#ifndef ORCA_QUIRKS_H
+#define ORCA_QUIRKS_H
+#include <stdbool.h>
+
+// behaviours that differ between chip-8 implementations. the interpreter is
+// instantiated once per profile with these as compile-time constants (see cpu.c),
+// so a machine pays for its profile's choices and nothing else.
+typedef struct {
+    bool vf_reset;         // 8XY1/8XY2/8XY3 clear VF
+    bool shift_vy;         // 8XY6/8XYE shift Vy into Vx rather than Vx in place
+    bool memory_increment; // FX55/FX65 leave I past the last byte touched
+    bool clip;             // DXYN clips at the screen edge instead of wrapping
+    bool jump_vx;          // BNNN is BXNN: jump to XNN + Vx
+} quirks;
+
+typedef enum {
+    PROFILE_VIP,    // the original COSMAC VIP interpreter
+    PROFILE_SCHIP,  // SUPER-CHIP 1.1 on the HP 48
+    PROFILE_XOCHIP, // Octo's XO-CHIP
+    PROFILE_COUNT
+} quirk_profile;
+
+#define QUIRKS_VIP ((quirks) {.vf_reset = true, .shift_vy = true, .memory_increment = true, .clip = true, .jump_vx = false})
+#define QUIRKS_SCHIP ((quirks) {.vf_reset = false, .shift_vy = false, .memory_increment = false, .clip = true, .jump_vx = true})
+#define QUIRKS_XOCHIP ((quirks) {.vf_reset = false, .shift_vy = true, .memory_increment = true, .clip = false, .jump_vx = false})
+
+const char *profile_name(quirk_profile profile);
+bool profile_parse(const char *name, quirk_profile *out);
+quirks profile_quirks(quirk_profile profile);
+#endif //ORCA_QUIRKS_H
@@ -0,0 +1,65 @@
+#ifndef ORCA_REWIND_H
+#define ORCA_REWIND_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <main.h>
+#include <debug.h>
+
+// default memory budget for checkpoints and the input log
+#define REWIND_BUDGET (64u << 20)
+// starting checkpoint spacing in instructions; doubles whenever the budget is hit
+#define REWIND_INTERVAL 1024
+
+// a run of identical frames: the keys latched at each start and how many
+// instructions ran before the next frame. begin_frame() is replayed only for
+// records marked as a boundary; the others continue the previous frame (the
+// start of the log, a frame that ran more than 32767 instructions, or a key
+// event inside the frame, replayed as set_keys() when its keys differ).
+// consecutive equal frames share one record, so steady input costs almost nothing.
+typedef struct {
+    uint32_t keys : 16;
+    uint32_t steps : 15;
+    uint32_t boundary : 1;
+    uint32_t repeat;
+} frame_record;
+
+#define FRAME_MAX_STEPS 0x7fff
+
+// what the instructions between two checkpoints did, so reverse searches only
+// re-execute the segments that could hold what they look for
+typedef struct {
+    uint64_t pcs[MEMORY_SIZE / 64]; // addresses an instruction ran from, one bit each
+    uint16_t pages;                 // MEMORY_PAGE pages FX33/FX55 wrote
+} segment_summary;
+
+typedef struct {
+    chip_8 state;   // machine right before the first frame of record `frame` began
+    uint32_t frame;
+    segment_summary after; // up to the next checkpoint; the last one's is not kept yet
+} checkpoint;
+
+typedef struct {
+    checkpoint *checkpoints;
+    int checkpoint_count;
+    int checkpoint_capacity;
+    frame_record *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    uint64_t interval;
+    uint64_t next_checkpoint;
+    size_t budget;
+} rewind_log;
+
+bool rewind_init(rewind_log *r, size_t budget);
+void rewind_free(rewind_log *r);
+void rewind_reset(rewind_log *r, const chip_8 *c);
+void rewind_begin_frame(rewind_log *r, chip_8 *c, uint16_t keys);
+void rewind_add_steps(rewind_log *r, chip_8 *c, int steps);
+void rewind_key_event(rewind_log *r, chip_8 *c, uint16_t keys);
+bool rewind_seek(rewind_log *r, chip_8 *c, uint64_t cycle);
+bool rewind_step_back(rewind_log *r, chip_8 *c);
+bool rewind_continue_back(rewind_log *r, chip_8 *c, debugger *d);
+bool rewind_last_write(rewind_log *r, const chip_8 *c, uint16_t start, uint16_t end, uint64_t *cycle, uint16_t *pc);
+size_t rewind_memory(const rewind_log *r);
+#endif //ORCA_REWIND_H
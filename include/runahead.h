@@ -0,0 +1,19 @@
+#ifndef ORCA_RUNAHEAD_H
+#define ORCA_RUNAHEAD_H
+#include <stdint.h>
+#include <main.h>
+
+#define RUN_AHEAD_MAX 3
+
+// run-ahead: after the live machine runs its frame, a copy of it runs `frames` more
+// with the same keys held, and the copy is what gets presented. a key press reaches
+// the screen `frames` frames sooner. the copy is a plain struct assignment and the
+// rollback is dropping it, so the live machine, the rewind log and the debugger never
+// see the speculated frames.
+typedef struct {
+    chip_8 ahead;
+    int frames; // 0 disables it
+} run_ahead;
+
+const chip_8 *run_ahead_frame(run_ahead *ra, const chip_8 *live, uint16_t keys, int steps_per_frame);
+#endif //ORCA_RUNAHEAD_H
@@ -0,0 +1,13 @@
+#ifndef ORCA_SHA1_H
+#define ORCA_SHA1_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_SIZE 20
+// 40 hex digits plus the terminator
+#define SHA1_HEX_SIZE 41
+
+// ROM identity for the quirk database and the library; not used for anything security related
+void sha1(const uint8_t *data, size_t size, uint8_t out[SHA1_SIZE]);
+void sha1_hex(const uint8_t digest[SHA1_SIZE], char out[SHA1_HEX_SIZE]);
+#endif //ORCA_SHA1_H
@@ -0,0 +1,32 @@
+#ifndef ORCA_STATEHASH_H
+#define ORCA_STATEHASH_H
+#include <stdint.h>
+#include <main.h>
+
+// incremental hashing of the machine, zobrist-style: every pixel and every memory
+// address has a pseudo-random 64-bit key. the display hash is the XOR of the keys of
+// lit pixels, so a pixel toggle XORs its key. a full (address, value) table for memory
+// would be 8 MB, so the memory hash is the sum of key * byte instead, and a write adds
+// key * (new - old). chip_8.memory_hash and chip_8.display_hash follow the 6 KB of
+// state for one multiply per written byte. the keys are filled in before main() runs;
+// a blank machine hashes to 0.
+
+extern uint64_t zobrist_addr[MEMORY_SIZE];
+extern uint64_t zobrist_pixels[SCREEN_WIDTH][SCREEN_HEIGHT];
+
+static inline uint64_t zobrist_delta(uint16_t addr, uint8_t old, uint8_t value) {
+    return zobrist_addr[addr] * (uint64_t) ((int64_t) value - old);
+}
+
+static inline void write_memory(chip_8 *c, uint16_t addr, uint8_t value) {
+    c->memory_hash += zobrist_delta(addr, c->memory[addr], value);
+    c->memory[addr] = value;
+    c->written |= 1u << (addr / MEMORY_PAGE);
+}
+
+uint64_t memory_hash_full(const chip_8 *c);
+uint64_t display_hash_full(const chip_8 *c);
+uint64_t program_hash(const chip_8 *c);
+uint64_t position_hash(const chip_8 *c);
+uint64_t machine_hash(const chip_8 *c);
+#endif //ORCA_STATEHASH_H
@@ -0,0 +1,49 @@
+#ifndef ORCA_TAS_H
+#define ORCA_TAS_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <main.h>
+
+// default memory budget for the greenzone
+#define TAS_BUDGET (32u << 20)
+// starting greenzone spacing in frames; doubles whenever the budget is hit
+#define TAS_INTERVAL 8
+// greenzone states this close to the cursor survive thinning, so editing near it stays cheap
+#define TAS_NEAR 256
+
+// a greenzone state: the machine at the start of `frame`, stored as the bytes that
+// differ from the movie's first frame
+typedef struct {
+    uint32_t frame;
+    uint32_t size;
+    uint8_t *data;
+} greenzone_state;
+
+// an input movie and the states it passes through. editing a frame only invalidates
+// the greenzone after it, and any frame is reached by decoding the nearest state
+// before it and running forward at most `interval` frames.
+typedef struct {
+    uint16_t *keys; // keys held during each frame
+    uint32_t length;
+    uint32_t capacity;
+    greenzone_state *zone; // sorted by frame, zone[0] is frame 0
+    int zone_count;
+    int zone_capacity;
+    size_t zone_bytes;
+    size_t budget;
+    uint32_t interval;
+    int steps_per_frame;
+    chip_8 origin; // the machine at frame 0
+    chip_8 now;    // the machine at the start of frame `cursor`
+    uint32_t cursor;
+    uint64_t resimulated; // frames run by seeks
+} tas_movie;
+
+bool tas_init(tas_movie *t, const chip_8 *start, int steps_per_frame, size_t budget);
+void tas_free(tas_movie *t);
+uint16_t tas_keys(const tas_movie *t, uint32_t frame);
+bool tas_set_keys(tas_movie *t, uint32_t frame, uint16_t keys);
+void tas_seek(tas_movie *t, uint32_t frame);
+size_t tas_memory(const tas_movie *t);
+#endif //ORCA_TAS_H
@@ -0,0 +1,18 @@
+#ifndef ORCA_TASVIEW_H
+#define ORCA_TASVIEW_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <tas.h>
+#include <raylib.h>
+
+#define TAS_ROWS 16
+
+// piano roll over a movie: one row per frame, one column per key
+typedef struct {
+    uint32_t top;   // first frame shown
+    bool playing;   // advance one frame per GUI frame
+    bool recording; // while playing, held keys overwrite the movie
+} tas_view;
+
+void draw_tas_view(tas_view *v, tas_movie *t, Rectangle bounds);
+#endif //ORCA_TASVIEW_H
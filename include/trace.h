@@ -0,0 +1,27 @@
+#ifndef ORCA_TRACE_H
+#define ORCA_TRACE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// events kept per thread; recording silently stops once a buffer is full
+#define TRACE_EVENTS_PER_THREAD (1 << 16)
+
+extern volatile bool trace_enabled;
+
+void trace_begin(const char *name);
+void trace_end(const char *name);
+void trace_set_thread_name(const char *name);
+void trace_start(void);
+void trace_stop(void);
+bool trace_dump(const char *filename);
+
+// zone markers: a single well-predicted branch while tracing is off.
+// names must be string literals (or otherwise outlive the dump).
+#define TRACE_BEGIN(name) do { if (__builtin_expect(trace_enabled, 0)) trace_begin(name); } while (0)
+#define TRACE_END(name) do { if (__builtin_expect(trace_enabled, 0)) trace_end(name); } while (0)
+
+// wrap a block in a zone, in the spirit of foreach(); don't `break`/`return` out of it
+#define TRACE_ZONE(name) \
+    for (int trace_once = (trace_enabled ? trace_begin(name) : (void) 0, 1); trace_once; \
+         trace_once = 0, trace_enabled ? trace_end(name) : (void) 0)
+#endif //ORCA_TRACE_H
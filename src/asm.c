@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <asm.h>
+
+// a small assembler for a subset of Octo (https://github.com/JohnEarnest/Octo):
+//
+//   : label             define a label at the current address
+//   :const name value   define a named constant
+//   clear  return  ;    00E0, 00EE, 00EE
+//   jump a  jump0 a     1NNN, BNNN
+//   :call a  label      2NNN (a bare label name is a call)
+//   vx := n|vy|random n|delay|key
+//   vx += n|vy  vx -= vy  vx =- vy  vx |= vy  vx &= vy  vx ^= vy  vx >>= vy  vx <<= vy
+//   i := n|label|hex vx   i += vx   delay := vx   buzzer := vx
+//   sprite vx vy n   save vx   load vx   bcd vx
+//   if vx ==|!= n|vy then <statement>    if vx key|-key then <statement>
+//   loop ... again      with optional `while <condition>` inside
+//   any bare number     emits one data byte
+//
+// numbers are decimal, 0x hex or 0b binary. `#` starts a comment.
+
+#define ASM_MAX_LABELS 512
+#define ASM_MAX_FIXUPS 1024
+#define ASM_MAX_LOOPS 16
+#define ASM_MAX_BREAKS 64
+#define ASM_MAX_LINE 512
+// tokens are separated by whitespace, so a line can't hold more than this
+#define ASM_MAX_TOKENS (ASM_MAX_LINE / 2)
+
+typedef struct {
+    char name[32];
+    int value;
+} asm_symbol;
+
+typedef struct {
+    char name[32];
+    int addr; // offset of the opcode to patch (low 12 bits receive the label)
+    int line;
+} asm_fixup;
+
+typedef struct {
+    asm_result *out;
+    asm_symbol symbols[ASM_MAX_LABELS];
+    int symbol_count;
+    asm_fixup fixups[ASM_MAX_FIXUPS];
+    int fixup_count;
+    int loops[ASM_MAX_LOOPS];
+    int loop_depth;
+    int breaks[ASM_MAX_BREAKS]; // `while` jumps waiting for their `again`
+    int break_loop[ASM_MAX_BREAKS];
+    int break_count;
+    int line;
+    char *tok[ASM_MAX_TOKENS];
+    int ntok;
+    int pos;
+} asm_state;
+
+static bool fail(asm_state *s, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(s->out->error, sizeof(s->out->error), fmt, args);
+    va_end(args);
+    s->out->error_line = s->line;
+    return false;
+}
+
+static const char *next(asm_state *s) {
+    return s->pos < s->ntok ? s->tok[s->pos++] : NULL;
+}
+
+static const char *peek(asm_state *s) {
+    return s->pos < s->ntok ? s->tok[s->pos] : NULL;
+}
+
+static bool emit(asm_state *s, uint16_t op) {
+    if (s->out->size + 2 > ASM_MAX_SIZE) return fail(s, "program too large");
+    s->out->code[s->out->size++] = op >> 8;
+    s->out->code[s->out->size++] = op & 0xff;
+    return true;
+}
+
+static bool emit_byte(asm_state *s, uint8_t b) {
+    if (s->out->size + 1 > ASM_MAX_SIZE) return fail(s, "program too large");
+    s->out->code[s->out->size++] = b;
+    return true;
+}
+
+static asm_symbol *find_symbol(asm_state *s, const char *name) {
+    for (int i = 0; i < s->symbol_count; i++) {
+        if (!strcmp(s->symbols[i].name, name)) return &s->symbols[i];
+    }
+    return NULL;
+}
+
+static bool define_symbol(asm_state *s, const char *name, int value) {
+    if (find_symbol(s, name)) return fail(s, "duplicate symbol '%s'", name);
+    if (s->symbol_count >= ASM_MAX_LABELS) return fail(s, "too many symbols");
+    if (strlen(name) >= sizeof(s->symbols[0].name)) return fail(s, "symbol name too long");
+    asm_symbol *sym = &s->symbols[s->symbol_count++];
+    strcpy(sym->name, name);
+    sym->value = value;
+    return true;
+}
+
+static bool parse_number(const char *t, int *value) {
+    if (!t) return false;
+    char *end;
+    long v;
+    if (t[0] == '0' && t[1] == 'b') {
+        v = strtol(t + 2, &end, 2);
+    } else if (t[0] == '-' && t[1] && isdigit((unsigned char) t[1])) {
+        v = strtol(t, &end, 0);
+    } else if (isdigit((unsigned char) t[0])) {
+        v = strtol(t, &end, 0);
+    } else {
+        return false;
+    }
+    if (*end) return false;
+    *value = (int) v;
+    return true;
+}
+
+// returns the register index of "vX", or -1
+static int parse_reg(const char *t) {
+    if (!t || (t[0] != 'v' && t[0] != 'V') || !t[1] || t[2]) return -1;
+    if (isdigit((unsigned char) t[1])) return t[1] - '0';
+    char h = (char) tolower((unsigned char) t[1]);
+    if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+    return -1;
+}
+
+// a numeric literal or a known constant/label
+static bool parse_value(asm_state *s, const char *t, int *value) {
+    if (parse_number(t, value)) return true;
+    asm_symbol *sym = t ? find_symbol(s, t) : NULL;
+    if (sym) {
+        *value = sym->value;
+        return true;
+    }
+    return false;
+}
+
+static bool expect_reg(asm_state *s, int *reg) {
+    const char *t = next(s);
+    *reg = parse_reg(t);
+    if (*reg < 0) return fail(s, "expected register, got '%s'", t ? t : "end of line");
+    return true;
+}
+
+static bool expect_byte(asm_state *s, int *value) {
+    const char *t = next(s);
+    if (!parse_value(s, t, value)) return fail(s, "expected number, got '%s'", t ? t : "end of line");
+    if (*value < -128 || *value > 255) return fail(s, "value %d doesn't fit in a byte", *value);
+    *value &= 0xff;
+    return true;
+}
+
+// emit an opcode whose low 12 bits are an address, resolving it later if needed
+static bool emit_addr(asm_state *s, uint16_t op, const char *t) {
+    if (!t) return fail(s, "expected address");
+    int value;
+    if (parse_value(s, t, &value)) {
+        if (value < 0 || value > 0xfff) return fail(s, "address 0x%x out of range", value);
+        return emit(s, op | value);
+    }
+    if (s->fixup_count >= ASM_MAX_FIXUPS) return fail(s, "too many forward references");
+    if (strlen(t) >= sizeof(s->fixups[0].name)) return fail(s, "label name too long");
+    asm_fixup *f = &s->fixups[s->fixup_count++];
+    strcpy(f->name, t);
+    f->addr = s->out->size;
+    f->line = s->line;
+    return emit(s, op);
+}
+
+// parse "vx == n", "vx != vy", "vx key", "vx -key" and produce the opcode that skips
+// the next instruction when the condition holds.
+static bool parse_condition(asm_state *s, uint16_t *skip_if_true) {
+    int x;
+    if (!expect_reg(s, &x)) return false;
+    const char *op = next(s);
+    if (!op) return fail(s, "incomplete condition");
+    if (!strcmp(op, "key")) {
+        *skip_if_true = 0xE09E | (x << 8);
+        return true;
+    }
+    if (!strcmp(op, "-key")) {
+        *skip_if_true = 0xE0A1 | (x << 8);
+        return true;
+    }
+    bool eq;
+    if (!strcmp(op, "==")) {
+        eq = true;
+    } else if (!strcmp(op, "!=")) {
+        eq = false;
+    } else {
+        return fail(s, "unsupported comparison '%s'", op);
+    }
+    const char *rhs = next(s);
+    int y = parse_reg(rhs);
+    if (y >= 0) {
+        *skip_if_true = (eq ? 0x5000 : 0x9000) | (x << 8) | (y << 4);
+        return true;
+    }
+    int n;
+    if (!parse_value(s, rhs, &n) || n < 0 || n > 255) return fail(s, "expected register or byte after '%s'", op);
+    *skip_if_true = (eq ? 0x3000 : 0x4000) | (x << 8) | n;
+    return true;
+}
+
+// the opposite skip: 3<->4, 5<->9, E09E<->E0A1
+static uint16_t invert_skip(uint16_t op) {
+    switch (op >> 12) {
+        case 0x3: return (op & 0x0fff) | 0x4000;
+        case 0x4: return (op & 0x0fff) | 0x3000;
+        case 0x5: return (op & 0x0fff) | 0x9000;
+        case 0x9: return (op & 0x0fff) | 0x5000;
+        default: return (op & 0xff) == 0x9e ? (op & 0xff00) | 0xa1 : (op & 0xff00) | 0x9e;
+    }
+}
+
+static bool statement(asm_state *s);
+
+static bool register_statement(asm_state *s, int x) {
+    const char *op = next(s);
+    const char *rhs = next(s);
+    if (!op || !rhs) return fail(s, "incomplete register statement");
+    int y = parse_reg(rhs);
+    int n;
+    if (!strcmp(op, ":=")) {
+        if (y >= 0) return emit(s, 0x8000 | (x << 8) | (y << 4));
+        if (!strcmp(rhs, "delay")) return emit(s, 0xF007 | (x << 8));
+        if (!strcmp(rhs, "key")) return emit(s, 0xF00A | (x << 8));
+        if (!strcmp(rhs, "random")) {
+            if (!expect_byte(s, &n)) return false;
+            return emit(s, 0xC000 | (x << 8) | n);
+        }
+        s->pos--;
+        if (!expect_byte(s, &n)) return false;
+        return emit(s, 0x6000 | (x << 8) | n);
+    }
+    if (!strcmp(op, "+=") && y < 0) {
+        s->pos--;
+        if (!expect_byte(s, &n)) return false;
+        return emit(s, 0x7000 | (x << 8) | n);
+    }
+    static const struct {
+        const char *op;
+        uint16_t nibble;
+    } alu[] = {
+        {"|=", 0x1}, {"&=", 0x2}, {"^=", 0x3}, {"+=", 0x4}, {"-=", 0x5}, {">>=", 0x6}, {"=-", 0x7}, {"<<=", 0xE},
+    };
+    if (y < 0) return fail(s, "expected register after '%s'", op);
+    for (size_t i = 0; i < sizeof(alu) / sizeof(*alu); i++) {
+        if (!strcmp(op, alu[i].op)) return emit(s, 0x8000 | (x << 8) | (y << 4) | alu[i].nibble);
+    }
+    return fail(s, "unknown operator '%s'", op);
+}
+
+static bool statement(asm_state *s) {
+    const char *t = next(s);
+    int x, y, n;
+    if (!t) return fail(s, "expected statement");
+
+    if ((x = parse_reg(t)) >= 0) return register_statement(s, x);
+
+    if (!strcmp(t, ":")) {
+        const char *name = next(s);
+        if (!name) return fail(s, "expected label name");
+        return define_symbol(s, name, PRG_ADDR + s->out->size);
+    }
+    if (!strcmp(t, ":const")) {
+        const char *name = next(s);
+        if (!name || !parse_value(s, next(s), &n)) return fail(s, "expected ':const name value'");
+        return define_symbol(s, name, n);
+    }
+    if (!strcmp(t, "clear")) return emit(s, 0x00E0);
+    if (!strcmp(t, "return") || !strcmp(t, ";")) return emit(s, 0x00EE);
+    if (!strcmp(t, "jump")) return emit_addr(s, 0x1000, next(s));
+    if (!strcmp(t, "jump0")) return emit_addr(s, 0xB000, next(s));
+    if (!strcmp(t, ":call")) return emit_addr(s, 0x2000, next(s));
+    if (!strcmp(t, "i")) {
+        const char *op = next(s);
+        const char *rhs = next(s);
+        if (op && rhs && !strcmp(op, ":=")) {
+            if (!strcmp(rhs, "hex")) {
+                if (!expect_reg(s, &x)) return false;
+                return emit(s, 0xF029 | (x << 8));
+            }
+            return emit_addr(s, 0xA000, rhs);
+        }
+        if (op && rhs && !strcmp(op, "+=") && (x = parse_reg(rhs)) >= 0) return emit(s, 0xF01E | (x << 8));
+        return fail(s, "unsupported i statement");
+    }
+    if (!strcmp(t, "delay") || !strcmp(t, "buzzer")) {
+        const char *op = next(s);
+        if (!op || strcmp(op, ":=") || !expect_reg(s, &x)) return fail(s, "expected '%s := vx'", t);
+        return emit(s, (t[0] == 'd' ? 0xF015 : 0xF018) | (x << 8));
+    }
+    if (!strcmp(t, "sprite")) {
+        if (!expect_reg(s, &x) || !expect_reg(s, &y)) return false;
+        if (!parse_value(s, next(s), &n) || n < 0 || n > 15) return fail(s, "sprite height must be 0-15");
+        return emit(s, 0xD000 | (x << 8) | (y << 4) | n);
+    }
+    if (!strcmp(t, "save")) return expect_reg(s, &x) && emit(s, 0xF055 | (x << 8));
+    if (!strcmp(t, "load")) return expect_reg(s, &x) && emit(s, 0xF065 | (x << 8));
+    if (!strcmp(t, "bcd")) return expect_reg(s, &x) && emit(s, 0xF033 | (x << 8));
+    if (!strcmp(t, "if")) {
+        uint16_t skip;
+        if (!parse_condition(s, &skip)) return false;
+        const char *then = next(s);
+        if (!then || strcmp(then, "then")) return fail(s, "expected 'then'");
+        // the body runs when the condition holds, so skip it when it doesn't
+        if (!emit(s, invert_skip(skip))) return false;
+        return statement(s);
+    }
+    if (!strcmp(t, "loop")) {
+        if (s->loop_depth >= ASM_MAX_LOOPS) return fail(s, "loops nested too deeply");
+        s->loops[s->loop_depth++] = PRG_ADDR + s->out->size;
+        return true;
+    }
+    if (!strcmp(t, "while")) {
+        uint16_t skip;
+        if (s->loop_depth == 0) return fail(s, "'while' outside of a loop");
+        if (!parse_condition(s, &skip)) return false;
+        if (s->break_count >= ASM_MAX_BREAKS) return fail(s, "too many 'while' statements");
+        if (!emit(s, skip)) return false;
+        s->breaks[s->break_count] = s->out->size;
+        s->break_loop[s->break_count++] = s->loop_depth;
+        return emit(s, 0x1000);
+    }
+    if (!strcmp(t, "again")) {
+        if (s->loop_depth == 0) return fail(s, "'again' without 'loop'");
+        if (!emit(s, 0x1000 | s->loops[s->loop_depth - 1])) return false;
+        uint16_t end = PRG_ADDR + s->out->size;
+        int kept = 0;
+        for (int i = 0; i < s->break_count; i++) {
+            if (s->break_loop[i] == s->loop_depth) {
+                s->out->code[s->breaks[i]] |= end >> 8;
+                s->out->code[s->breaks[i] + 1] = end & 0xff;
+            } else {
+                s->breaks[kept] = s->breaks[i];
+                s->break_loop[kept++] = s->break_loop[i];
+            }
+        }
+        s->break_count = kept;
+        s->loop_depth--;
+        return true;
+    }
+    if (parse_number(t, &n)) {
+        if (n < -128 || n > 255) return fail(s, "data byte %d out of range", n);
+        return emit_byte(s, n & 0xff);
+    }
+    // anything else is a call to a (possibly forward) label
+    return emit_addr(s, 0x2000, t);
+}
+
+bool assemble(const char *source, asm_result *out) {
+    static asm_state s;
+    memset(&s, 0, sizeof(s));
+    memset(out, 0, sizeof(*out));
+    s.out = out;
+
+    const char *p = source;
+    char line[ASM_MAX_LINE];
+    while (*p) {
+        const char *eol = strchr(p, '\n');
+        size_t len = eol ? (size_t) (eol - p) : strlen(p);
+        s.line++;
+        if (len >= sizeof(line)) return fail(&s, "line longer than %d characters", ASM_MAX_LINE - 1);
+        memcpy(line, p, len);
+        line[len] = 0;
+        p = eol ? eol + 1 : p + len;
+
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        s.ntok = 0;
+        for (char *t = strtok(line, " \t\r"); t; t = strtok(NULL, " \t\r")) {
+            s.tok[s.ntok++] = t;
+        }
+        s.pos = 0;
+        while (peek(&s)) {
+            if (!statement(&s)) return false;
+        }
+    }
+    s.line = 0;
+    if (s.loop_depth) return fail(&s, "'loop' without 'again'");
+
+    for (int i = 0; i < s.fixup_count; i++) {
+        asm_fixup *f = &s.fixups[i];
+        asm_symbol *sym = find_symbol(&s, f->name);
+        s.line = f->line;
+        if (!sym) return fail(&s, "undefined label '%s'", f->name);
+        if (sym->value < 0 || sym->value > 0xfff) return fail(&s, "address of '%s' out of range", f->name);
+        out->code[f->addr] |= sym->value >> 8;
+        out->code[f->addr + 1] = sym->value & 0xff;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <bootcache.h>
+#include <cpu.h>
+
+// boot snapshots: the state a ROM reaches before it first looks at the keypad. no
+// input can change anything up to that point, so the snapshot is exact for every
+// player, and loading it is the same as having sat through the title screen.
+
+static const char boot_magic[8] = "ORCABOOT";
+
+static bool reads_keys(uint16_t op) {
+    return (op & 0xf0ff) == 0xe09e || (op & 0xf0ff) == 0xe0a1 || (op & 0xf0ff) == 0xf00a;
+}
+
+// advance a freshly loaded, running machine through the frames that can't depend on
+// input. it stops at the frame boundary before the first instruction that reads the
+// keypad, before a frame that traps, or after max_frames. returns the frames skipped.
+long boot_prefix(chip_8 *c, int steps_per_frame, long max_frames) {
+    chip_8 *start = chip_alloc();
+    if (!start) return 0;
+    long f = 0;
+    for (; f < max_frames && c->running; f++) {
+        *start = *c;
+        begin_frame(c, 0);
+        bool input = false;
+        for (int i = 0; i < steps_per_frame && c->running; i++) {
+            if (reads_keys(opcode_at(c, c->pc))) {
+                input = true;
+                break;
+            }
+            step(c);
+        }
+        if (input || !c->running) {
+            // this frame has to run live
+            *c = *start;
+            break;
+        }
+    }
+    free(start);
+    return f;
+}
+
+static void cache_path(char *out, size_t size, const char *dir, const uint8_t sha1[SHA1_SIZE], uint8_t profile,
+                       int steps_per_frame) {
+    char hex[SHA1_HEX_SIZE];
+    sha1_hex(sha1, hex);
+    snprintf(out, size, "%s/%s-%s-%d.boot", dir, hex, profile_name(profile), steps_per_frame);
+}
+
+static boot_header make_header(const uint8_t sha1[SHA1_SIZE], uint8_t profile, int steps_per_frame, long frames) {
+    boot_header h = {.version = BOOT_CACHE_VERSION, .state_size = sizeof(chip_8)};
+    memcpy(h.magic, boot_magic, sizeof(h.magic));
+    memcpy(h.sha1, sha1, SHA1_SIZE);
+    h.profile = profile;
+    h.steps_per_frame = steps_per_frame;
+    h.frames = frames;
+    return h;
+}
+
+// replace *c with the cached post-boot state if there is a valid one for this ROM,
+// c's profile and this speed. c must hold the ROM, freshly loaded.
+bool boot_cache_load(const char *dir, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, chip_8 *c, long *frames) {
+    char path[512];
+    cache_path(path, sizeof(path), dir, sha1, c->profile, steps_per_frame);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    boot_header h, want = make_header(sha1, c->profile, steps_per_frame, 0);
+    chip_8 *state = chip_alloc();
+    bool ok = state && fread(&h, sizeof(h), 1, fp) == 1 && fread(state, sizeof(chip_8), 1, fp) == 1;
+    fclose(fp);
+    // everything but the prefix length has to match what was asked for
+    want.frames = ok ? h.frames : 0;
+    ok = ok && !memcmp(&h, &want, sizeof(h)) && h.frames <= BOOT_MAX_FRAMES;
+    if (ok) {
+        *c = *state;
+        *frames = h.frames;
+    }
+    free(state);
+    return ok;
+}
+
+bool boot_cache_store(const char *dir, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, const chip_8 *c,
+                      long frames) {
+    mkdir(dir, 0755);
+    char path[512], tmp[520];
+    cache_path(path, sizeof(path), dir, sha1, c->profile, steps_per_frame);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return false;
+    boot_header h = make_header(sha1, c->profile, steps_per_frame, frames);
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(c, sizeof(chip_8), 1, fp) == 1;
+    ok = fclose(fp) == 0 && ok && rename(tmp, path) == 0;
+    if (!ok) fprintf(stderr, "[!] failed to write %s\n", path);
+    return ok;
+}
+
+// jump a freshly loaded, running machine past its boot sequence: from the cache if it
+// has this ROM, otherwise by running the prefix and caching the result. returns the
+// number of frames skipped; *cached says which way it went.
+long boot_skip(chip_8 *c, const uint8_t sha1[SHA1_SIZE], int steps_per_frame, const char *dir, bool *cached) {
+    long frames = 0;
+    *cached = boot_cache_load(dir, sha1, steps_per_frame, c, &frames);
+    if (*cached) return frames;
+    frames = boot_prefix(c, steps_per_frame, BOOT_MAX_FRAMES);
+    if (frames > 0) boot_cache_store(dir, sha1, steps_per_frame, c, frames);
+    return frames;
+}
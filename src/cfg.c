@@ -0,0 +1,377 @@
+#include <string.h>
+#include <cfg.h>
+#include <cpu.h>
+#include <quirks.h>
+
+// static control-flow recovery. instructions are found by recursive descent from the
+// entry point: each walk runs straight on until a jump, return or unknown opcode and
+// queues every jump, call and skip target it passes. I is followed within a walk
+// (ANNN sets it, anything else that changes it forgets it), which is enough to tell
+// the sprites and tables DXYN and FX65 read, and the code FX33 and FX55 overwrite.
+
+typedef enum {
+    OP_PLAIN,
+    OP_JUMP,
+    OP_CALL,
+    OP_RETURN,
+    OP_SKIP,
+    OP_INDIRECT,
+    OP_ILLEGAL,
+} op_class;
+
+// what the instruction does to control flow, matching what step() would do with it
+static op_class classify(uint16_t op) {
+    uint8_t lo = op & 0xff;
+    switch (op >> 12) {
+        case 0x0:
+            if (op == 0x00E0) return OP_PLAIN;
+            return op == 0x00EE ? OP_RETURN : OP_ILLEGAL;
+        case 0x1: return OP_JUMP;
+        case 0x2: return OP_CALL;
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+            return OP_SKIP;
+        case 0x8:
+            return (op & 0xf) <= 0x7 || (op & 0xf) == 0xe ? OP_PLAIN : OP_ILLEGAL;
+        case 0xb: return OP_INDIRECT;
+        case 0xe: return lo == 0x9e || lo == 0xa1 ? OP_SKIP : OP_ILLEGAL;
+        case 0xf:
+            switch (lo) {
+                case 0x07: case 0x0a: case 0x15: case 0x18: case 0x1e:
+                case 0x29: case 0x33: case 0x55: case 0x65:
+                    return OP_PLAIN;
+                default:
+                    return OP_ILLEGAL;
+            }
+        default:
+            return OP_PLAIN;
+    }
+}
+
+// instructions a polling loop is made of: nothing in it changes what it polls
+static bool waits(uint16_t op) {
+    switch (op >> 12) {
+        case 0x1: case 0x3: case 0x4: case 0x5: case 0x9:
+            return true;
+        case 0xe:
+            return classify(op) == OP_SKIP;
+        case 0xf:
+            return (op & 0xff) == 0x07;
+        default:
+            return false;
+    }
+}
+
+typedef struct {
+    uint16_t site;
+    uint16_t lo; // [lo, hi)
+    uint16_t hi;
+} write_span;
+
+typedef struct {
+    uint16_t work[MEMORY_SIZE];
+    int work_count;
+    write_span writes[256];
+    int write_count;
+} discovery;
+
+static void queue(cfg *g, discovery *d, uint16_t addr) {
+    g->flags[addr] |= CFG_LEADER;
+    if (!(g->flags[addr] & CFG_CODE) && d->work_count < MEMORY_SIZE) d->work[d->work_count++] = addr;
+}
+
+static void mark_data(cfg *g, uint16_t lo, uint16_t hi) {
+    for (uint16_t a = lo; a < hi && a < MEMORY_SIZE; a++) {
+        g->flags[a] |= CFG_DATA;
+    }
+}
+
+static void note_write(cfg *g, discovery *d, uint16_t site, uint16_t lo, uint16_t hi) {
+    if (d->write_count < (int) (sizeof(d->writes) / sizeof(d->writes[0]))) {
+        d->writes[d->write_count++] = (write_span) {site, lo, hi > MEMORY_SIZE ? MEMORY_SIZE : hi};
+    } else {
+        g->truncated = true;
+    }
+}
+
+static void walk(cfg *g, discovery *d, const chip_8 *c, uint16_t addr, quirks q) {
+    bool known = false;
+    uint16_t I = 0;
+    while (addr <= MEMORY_SIZE - 2) {
+        if (g->flags[addr] & CFG_CODE) {
+            // ran into an earlier walk: that instruction now starts a block
+            g->flags[addr] |= CFG_LEADER;
+            return;
+        }
+        g->flags[addr] |= CFG_CODE;
+        g->flags[addr + 1] |= CFG_OPERAND;
+        uint16_t op = opcode_at(c, addr);
+        uint8_t x = (op >> 8) & 0xf;
+        uint16_t nnn = op & 0xfff;
+        switch (classify(op)) {
+            case OP_JUMP:
+                queue(g, d, nnn);
+                return;
+            case OP_CALL:
+                g->flags[nnn] |= CFG_CALL_TARGET;
+                queue(g, d, nnn);
+                if (g->call_count < CFG_MAX_CALLS) {
+                    g->calls[g->call_count++] = (cfg_edge) {addr, nnn};
+                } else {
+                    g->truncated = true;
+                }
+                // the subroutine may set I to anything
+                known = false;
+                if (addr + 2 <= MEMORY_SIZE - 2) g->flags[addr + 2] |= CFG_LEADER;
+                break;
+            case OP_SKIP:
+                if (addr + 4 <= MEMORY_SIZE - 2) queue(g, d, addr + 4);
+                if (addr + 2 <= MEMORY_SIZE - 2) g->flags[addr + 2] |= CFG_LEADER;
+                break;
+            case OP_RETURN:
+                return;
+            case OP_INDIRECT:
+                if (g->indirect_count < CFG_MAX_SITES) {
+                    g->indirect[g->indirect_count++] = addr;
+                } else {
+                    g->truncated = true;
+                }
+                return;
+            case OP_ILLEGAL:
+                return;
+            case OP_PLAIN:
+                if ((op >> 12) == 0xa) {
+                    I = nnn;
+                    known = true;
+                } else if ((op >> 12) == 0xd) {
+                    if (known) mark_data(g, I, I + (op & 0xf));
+                } else if ((op & 0xf0ff) == 0xf033) {
+                    if (known) note_write(g, d, addr, I, I + 3);
+                } else if ((op & 0xf0ff) == 0xf055 || (op & 0xf0ff) == 0xf065) {
+                    if (known && (op & 0xff) == 0x55) note_write(g, d, addr, I, I + x + 1);
+                    if (known && (op & 0xff) == 0x65) mark_data(g, I, I + x + 1);
+                    if (q.memory_increment) I += x + 1;
+                } else if ((op & 0xf0ff) == 0xf01e || (op & 0xf0ff) == 0xf029) {
+                    known = false;
+                }
+                break;
+        }
+        addr += 2;
+    }
+}
+
+// split the found instructions into basic blocks
+static void build_blocks(cfg *g, const chip_8 *c) {
+    for (uint16_t a = 0; a <= MEMORY_SIZE - 2; a++) {
+        if ((g->flags[a] & (CFG_LEADER | CFG_CODE)) != (CFG_LEADER | CFG_CODE)) continue;
+        if (g->block_count == CFG_MAX_BLOCKS) {
+            g->truncated = true;
+            return;
+        }
+        int index = g->block_count++;
+        cfg_block *b = &g->blocks[index];
+        memset(b, 0, sizeof(*b));
+        b->start = a;
+        uint16_t at = a;
+        for (;;) {
+            g->block_of[at] = index;
+            uint16_t op = opcode_at(c, at);
+            uint16_t next = at + 2;
+            op_class kind = classify(op);
+            if (kind == OP_JUMP) {
+                b->kind = (op & 0xfff) == at ? BLOCK_HALTS : BLOCK_JUMPS;
+                b->succ[b->succ_count++] = op & 0xfff;
+            } else if (kind == OP_CALL) {
+                b->kind = BLOCK_CALLS;
+                if (next <= MEMORY_SIZE - 2) b->succ[b->succ_count++] = next;
+            } else if (kind == OP_SKIP) {
+                b->kind = BLOCK_BRANCHES;
+                if (next <= MEMORY_SIZE - 2) b->succ[b->succ_count++] = next;
+                if (next + 2 <= MEMORY_SIZE - 2) b->succ[b->succ_count++] = next + 2;
+            } else if (kind == OP_RETURN) {
+                b->kind = BLOCK_RETURNS;
+            } else if (kind == OP_INDIRECT) {
+                b->kind = BLOCK_INDIRECT;
+            } else if (kind == OP_ILLEGAL || next > MEMORY_SIZE - 2 || !(g->flags[next] & CFG_CODE)) {
+                b->kind = BLOCK_TRAPS;
+            } else if (g->flags[next] & CFG_LEADER) {
+                b->kind = BLOCK_FALLS;
+                b->succ[b->succ_count++] = next;
+            } else {
+                at = next;
+                continue;
+            }
+            b->end = next;
+            break;
+        }
+    }
+}
+
+typedef struct {
+    uint16_t pred_start[CFG_MAX_BLOCKS + 1];
+    uint16_t preds[CFG_MAX_BLOCKS * 2];
+    uint8_t state[CFG_MAX_BLOCKS]; // 0 unseen, 1 on the DFS path, 2 done
+    uint16_t stack[CFG_MAX_BLOCKS];
+    uint8_t next_succ[CFG_MAX_BLOCKS];
+    uint32_t seen[CFG_MAX_BLOCKS]; // loop body membership, by back edge number
+} loop_search;
+
+static int succ_block(const cfg *g, const cfg_block *b, int i) {
+    uint16_t target = b->succ[i];
+    if (!(g->flags[target] & CFG_CODE) || g->blocks[g->block_of[target]].start != target) return -1;
+    return g->block_of[target];
+}
+
+static void build_preds(const cfg *g, loop_search *s) {
+    memset(s->pred_start, 0, sizeof(s->pred_start));
+    for (int i = 0; i < g->block_count; i++) {
+        for (int k = 0; k < g->blocks[i].succ_count; k++) {
+            int t = succ_block(g, &g->blocks[i], k);
+            if (t >= 0) s->pred_start[t + 1]++;
+        }
+    }
+    for (int i = 0; i < g->block_count; i++) {
+        s->pred_start[i + 1] += s->pred_start[i];
+    }
+    uint16_t fill[CFG_MAX_BLOCKS];
+    memcpy(fill, s->pred_start, sizeof(uint16_t) * g->block_count);
+    for (int i = 0; i < g->block_count; i++) {
+        for (int k = 0; k < g->blocks[i].succ_count; k++) {
+            int t = succ_block(g, &g->blocks[i], k);
+            if (t >= 0) s->preds[fill[t]++] = i;
+        }
+    }
+}
+
+// the natural loop of the back edge tail -> head: head plus everything that reaches
+// tail without going through head
+static void mark_loop(cfg *g, loop_search *s, const chip_8 *c, int tail, int head) {
+    uint32_t stamp = ++g->loops;
+    g->flags[g->blocks[head].start] |= CFG_LOOP_HEAD;
+    uint16_t body[CFG_MAX_BLOCKS];
+    int count = 0;
+    s->seen[head] = stamp;
+    body[count++] = head;
+    if (s->seen[tail] != stamp) {
+        s->seen[tail] = stamp;
+        body[count++] = tail;
+    }
+    for (int i = 1; i < count; i++) {
+        for (int p = s->pred_start[body[i]]; p < s->pred_start[body[i] + 1]; p++) {
+            uint16_t pred = s->preds[p];
+            if (s->seen[pred] == stamp) continue;
+            s->seen[pred] = stamp;
+            body[count++] = pred;
+        }
+    }
+    bool idle = true;
+    for (int i = 0; i < count; i++) {
+        const cfg_block *b = &g->blocks[body[i]];
+        for (uint16_t a = b->start; a < b->end && idle; a += 2) {
+            idle = waits(opcode_at(c, a));
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        cfg_block *b = &g->blocks[body[i]];
+        if (b->loop_depth < 255) b->loop_depth++;
+        b->idle |= idle;
+    }
+    g->idle_loops += idle;
+}
+
+// a back edge is one that reaches a block still on the depth-first path
+static void find_loops(cfg *g, loop_search *s, const chip_8 *c, int root) {
+    if (s->state[root]) return;
+    int depth = 0;
+    s->stack[depth++] = root;
+    s->state[root] = 1;
+    s->next_succ[root] = 0;
+    while (depth) {
+        int b = s->stack[depth - 1];
+        const cfg_block *block = &g->blocks[b];
+        if (s->next_succ[b] == block->succ_count) {
+            s->state[b] = 2;
+            depth--;
+            continue;
+        }
+        int t = succ_block(g, block, s->next_succ[b]++);
+        if (t < 0) continue;
+        if (s->state[t] == 1) {
+            mark_loop(g, s, c, b, t);
+        } else if (!s->state[t]) {
+            s->state[t] = 1;
+            s->next_succ[t] = 0;
+            s->stack[depth++] = t;
+        }
+    }
+}
+
+static int block_starting_at(const cfg *g, uint16_t addr) {
+    if (addr >= MEMORY_SIZE || !(g->flags[addr] & CFG_CODE)) return -1;
+    uint16_t b = g->block_of[addr];
+    return b != CFG_NO_BLOCK && g->blocks[b].start == addr ? b : -1;
+}
+
+// analyse the ROM in `c` from PRG_ADDR, and from pc too if it is elsewhere
+void cfg_build(cfg *g, const chip_8 *c) {
+    memset(g->flags, 0, sizeof(g->flags));
+    memset(g->block_of, 0xff, sizeof(g->block_of));
+    g->block_count = 0;
+    g->call_count = 0;
+    g->indirect_count = 0;
+    g->self_mod_count = 0;
+    g->loops = 0;
+    g->idle_loops = 0;
+    g->truncated = false;
+
+    static _Thread_local discovery d;
+    d.work_count = 0;
+    d.write_count = 0;
+    quirks q = profile_quirks(c->profile);
+    queue(g, &d, PRG_ADDR);
+    if (c->pc != PRG_ADDR && c->pc <= MEMORY_SIZE - 2) queue(g, &d, c->pc);
+    while (d.work_count) {
+        walk(g, &d, c, d.work[--d.work_count], q);
+    }
+    build_blocks(g, c);
+
+    static _Thread_local loop_search s;
+    memset(s.state, 0, sizeof(s.state));
+    memset(s.seen, 0, sizeof(s.seen));
+    build_preds(g, &s);
+    int root = block_starting_at(g, PRG_ADDR);
+    if (root >= 0) find_loops(g, &s, c, root);
+    root = block_starting_at(g, c->pc);
+    if (root >= 0) find_loops(g, &s, c, root);
+    for (int i = 0; i < g->call_count; i++) {
+        root = block_starting_at(g, g->calls[i].target);
+        if (root >= 0) find_loops(g, &s, c, root);
+    }
+
+    for (int i = 0; i < d.write_count; i++) {
+        const write_span *w = &d.writes[i];
+        bool reported = false;
+        for (uint16_t a = w->lo; a < w->hi; a++) {
+            g->flags[a] |= CFG_WRITTEN;
+            if (reported || !(g->flags[a] & (CFG_CODE | CFG_OPERAND))) continue;
+            reported = true;
+            if (g->self_mod_count < CFG_MAX_SITES) {
+                g->self_mod[g->self_mod_count++] = (cfg_edge) {w->site, a};
+            } else {
+                g->truncated = true;
+            }
+        }
+    }
+
+    g->code_bytes = 0;
+    g->data_bytes = 0;
+    for (int a = 0; a < MEMORY_SIZE; a++) {
+        if (g->flags[a] & (CFG_CODE | CFG_OPERAND)) {
+            g->code_bytes++;
+        } else if (g->flags[a] & CFG_DATA) {
+            g->data_bytes++;
+        }
+    }
+}
@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <main.h>
+#include <cpu.h>
+#include <opcodes.h>
+#include <debug.h>
+#include <statehash.h>
+
+// a machine on the heap, starting on a cache line so its registers share one. release
+// it with free().
+chip_8 *chip_alloc(void) {
+    return aligned_alloc(CHIP_8_LINE, CHIP_8_ALLOC_SIZE);
+}
+
+void init(chip_8 *c) {
+    memset(c->memory, 0, MEMORY_SIZE);
+    memset(c->display, 0, SCREEN_HEIGHT * SCREEN_WIDTH);
+    memset(c->stack, 0, sizeof(c->stack));
+    memset(c->V, 0, 16);
+    c->keycur = 0;
+    c->keyold = 0;
+
+    memcpy(c->memory + FONT_ADDR, fontset, 80);
+    printf("[*] loaded font-set into memory\n");
+
+    c->pc = PRG_ADDR;
+    c->I = 0;
+    c->sp = 0;
+
+    c->delay_timer = 0;
+    c->sound_timer = 0;
+
+    c->running = false;
+    c->rng = RNG_SEED;
+    c->cycles = 0;
+    c->watchdog = 0;
+    c->trap = TRAP_NONE;
+    c->trap_pc = 0;
+    c->trap_op = 0;
+    c->profile = PROFILE_VIP;
+    c->written = 0;
+    c->memory_hash = memory_hash_full(c);
+    c->display_hash = 0;
+
+    printf("[*] init finished!\n");
+}
+
+static const char *trap_names[TRAP_COUNT] = {
+    "none",
+    "stack overflow",
+    "stack underflow",
+    "illegal opcode",
+    "bad address",
+    "watchdog timeout"
+};
+
+const char *trap_name(trap_kind kind) {
+    return kind < TRAP_COUNT ? trap_names[kind] : "?";
+}
+
+// traps are cold: keeping them out of line keeps step() as small as it was before
+static __attribute__((cold, noinline)) void trap_at(chip_8 *c, trap_kind kind, uint16_t pc) {
+    c->trap = kind;
+    c->trap_pc = pc;
+    c->trap_op = opcode_at(c, pc);
+    c->pc = pc;
+    c->running = false;
+}
+
+// stop the machine on the instruction being executed. opcode handlers run after the
+// fetch has moved pc on, so the faulting instruction is the one right before it;
+// pc is put back there so resuming (after fixing things up in the debugger) retries it.
+__attribute__((cold)) void raise_trap(chip_8 *c, trap_kind kind) {
+    trap_at(c, kind, c->pc - 2);
+}
+
+// trap after `instructions` more instructions, for batch runs of untrusted ROMs
+void set_watchdog(chip_8 *c, uint64_t instructions) {
+    c->watchdog = instructions ? c->cycles + instructions : 0;
+}
+
+static const char *profile_names[PROFILE_COUNT] = {"vip", "schip", "xochip"};
+
+const char *profile_name(quirk_profile profile) {
+    return profile < PROFILE_COUNT ? profile_names[profile] : "?";
+}
+
+bool profile_parse(const char *name, quirk_profile *out) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (!strcmp(name, profile_names[i])) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+quirks profile_quirks(quirk_profile profile) {
+    switch (profile) {
+        case PROFILE_SCHIP: return QUIRKS_SCHIP;
+        case PROFILE_XOCHIP: return QUIRKS_XOCHIP;
+        default: return QUIRKS_VIP;
+    }
+}
+
+// superinstructions: common idioms run as one dispatch. each is entered with pc past
+// its first instruction, which has already been decoded, and steps pc and cycles
+// through the rest exactly as separate dispatches would, so a trap inside one reports
+// the right instruction. the idiom is matched afresh from wherever pc is each time,
+// so jumping into the middle of one just runs its tail the ordinary way.
+
+static inline bool next_is(const chip_8 *c, int count, uint8_t nibble) {
+    return c->pc <= MEMORY_SIZE - 2 * count && (c->memory[c->pc] >> 4) == nibble;
+}
+
+// lazy flags: VF is dead after an instruction when the next one, which the batch is
+// certain to run straight after, writes VF without reading it and cannot trap before
+// doing so. nothing else can look at the machine between the two, so the debugger,
+// snapshots and hashes never see the difference, and step() never takes this path.
+// only DXYN asks: its collision test runs per pixel, while the carries and borrows of
+// 8XYN cost less than this lookahead. `budget` counts the asking instruction.
+static inline bool vf_dead(const chip_8 *c, const quirks q, int budget) {
+    if (budget < 2 || c->pc > MEMORY_SIZE - 2) return false;
+    uint8_t hi = c->memory[c->pc];
+    uint8_t lo = c->memory[c->pc + 1];
+    bool x_ok = (hi & 0xf) != 0xf, y_ok = (lo >> 4) != 0xf;
+    // 8XY4-8XY7 and 8XYE, plus 8XY1-8XY3 where they clear VF; a bit per low nibble
+    const uint16_t alu = q.vf_reset ? 0x40fe : 0x40f0;
+    uint8_t kind = hi >> 4;
+    if (kind == 0x8) return x_ok && y_ok && (alu >> (lo & 0xf) & 1);
+    if (kind == 0xd) return x_ok && y_ok && c->I + (lo & 0xf) <= MEMORY_SIZE;
+    if (x_ok) return false;
+    return kind == 0x6 || kind == 0xc || (kind == 0xf && lo == 0x07);
+}
+
+// DXYN, as a plain XOR without the collision test when VF is dead. DFYN and DXFN
+// keep the full path, which clears VF before reading the coordinates.
+static inline __attribute__((always_inline))
+void draw(chip_8 *c, const quirks q, uint8_t x, uint8_t y, uint8_t n, int budget) {
+    bool fast = x != 0xf && y != 0xf && c->I + n <= MEMORY_SIZE && vf_dead(c, q, budget);
+    if (q.clip) {
+        fast ? draw_sprite_xor(c, x, y, n) : draw_sprite(c, x, y, n);
+    } else {
+        fast ? draw_sprite_wrap_xor(c, x, y, n) : draw_sprite_wrap(c, x, y, n);
+    }
+}
+
+// 6XNN; 6YNN: loading coordinates or a pair of counters
+static inline int fused_load_pair(chip_8 *c, uint8_t x, uint8_t value) {
+    const uint8_t *m = &c->memory[c->pc];
+    set_reg(c, x, value);
+    set_reg(c, m[0] & 0xf, m[1]);
+    c->pc += 2;
+    c->cycles++;
+    return 2;
+}
+
+// ANNN or FX29 followed by DXYN: point I at a sprite or digit and draw it
+static inline __attribute__((always_inline)) int fused_draw(chip_8 *c, const quirks q, int budget) {
+    const uint8_t *m = &c->memory[c->pc];
+    c->pc += 2;
+    c->cycles++;
+    draw(c, q, m[0] & 0xf, m[1] >> 4, m[1] & 0xf, budget - 1);
+    return 2;
+}
+
+// 7XNN; 3YNN; 1NNN: a counted loop's step, test and jump back
+static inline int fused_count(chip_8 *c, uint8_t x, uint8_t value) {
+    const uint8_t *m = &c->memory[c->pc];
+    add_reg(c, x, value);
+    uint16_t test = c->pc;
+    c->pc += 2;
+    c->cycles++;
+    skip_equal(c, m[0] & 0xf, m[1]);
+    if (c->pc != test + 2) return 2;
+    c->pc += 2;
+    c->cycles++;
+    jmp_addr(c, (m[2] & 0xf) << 8 | m[3]);
+    return 3;
+}
+
+// FX07; 3XNN; 1NNN back to the FX07: waiting for the delay timer. it only changes
+// between run_steps() calls, so every pass in this batch goes the same way and as
+// many passes as fit run at once
+static inline int fused_timer_wait(chip_8 *c, uint8_t x, int budget) {
+    uint8_t target = c->memory[c->pc + 1];
+    c->V[x] = c->delay_timer;
+    if (c->V[x] == target) {
+        c->pc += 2;
+        c->cycles++;
+        skip_equal(c, x, target);
+        return 2;
+    }
+    int passes = budget / 3;
+    c->pc -= 2;
+    c->cycles += passes * 3 - 1;
+    return passes * 3;
+}
+
+// the interpreter body, instantiated once per profile below. q is always a
+// compile-time constant there, so every quirk test folds away and each instance
+// is as tight as if its behaviour had been hard-coded. up to `budget` instructions
+// may run as one superinstruction; step() passes 1, which folds them all away.
+// returns the number of instructions run.
+static inline __attribute__((always_inline))
+int step_with(chip_8 *c, const quirks q, const int budget) {
+    if (c->pc > MEMORY_SIZE - 2) {
+        trap_at(c, TRAP_BAD_ADDRESS, c->pc);
+        return 1;
+    }
+    uint8_t hi = c->memory[c->pc];
+    uint8_t lo = c->memory[c->pc + 1];
+    uint16_t full = (hi << 8) | lo;
+    c->pc += 2;
+    c->cycles++;
+#ifdef ORCA_TRACE_OPCODES
+    printf("0x%04x\n", full);
+#endif
+    switch (hi >> 4) {
+        case 0x0:
+            if (0x00E0 == full) {
+                clear_display(c);
+            } else if (full == 0x00EE) {
+                return_subroutine(c);
+            } else {
+                raise_trap(c, TRAP_ILLEGAL_OPCODE);
+            }
+            break;
+        case 0x1:
+            jmp_addr(c, full & 0xfff);
+            break;
+        case 0x2:
+            call_subroutine(c, full & 0xfff);
+            break;
+        case 0x3:
+            skip_equal(c, hi & 0xf, lo);
+            break;
+        case 0x4:
+            skip_not_equal(c, hi & 0xf, lo);
+            break;
+        case 0x5:
+            skip_equal_reg(c, hi & 0xf, lo >> 4);
+            break;
+        case 0x6:
+            if (budget >= 2 && next_is(c, 1, 0x6)) return fused_load_pair(c, hi & 0xf, lo);
+            set_reg(c, hi & 0xf, lo);
+            break;
+        case 0x7:
+            if (budget >= 3 && next_is(c, 2, 0x3) && (c->memory[c->pc + 2] >> 4) == 0x1 &&
+                ((c->memory[c->pc + 2] & 0xf) << 8 | c->memory[c->pc + 3]) != c->pc + 2) {
+                return fused_count(c, hi & 0xf, lo);
+            }
+            add_reg(c, hi & 0xf, lo);
+            break;
+        case 0x8:
+            switch (lo & 0xf) {
+                case 0x0:
+                    set_reg_to_reg(c, hi & 0xf, lo >> 4);
+                    break;
+                case 0x1:
+                    bit_or_reg(c, hi & 0xf, lo >> 4);
+                    if (q.vf_reset) c->V[0xf] = 0;
+                    break;
+                case 0x2:
+                    bit_and_reg(c, hi & 0xf, lo >> 4);
+                    if (q.vf_reset) c->V[0xf] = 0;
+                    break;
+                case 0x3:
+                    bit_xor_reg(c, hi & 0xf, lo >> 4);
+                    if (q.vf_reset) c->V[0xf] = 0;
+                    break;
+                case 0x4:
+                    add_reg_to_reg(c, hi & 0xf, lo >> 4);
+                    break;
+                case 0x5:
+                    sub_reg(c, hi & 0xf, lo >> 4);
+                    break;
+                case 0x6:
+                    if (q.shift_vy) c->V[hi & 0xf] = c->V[lo >> 4];
+                    shift_reg_right(c, hi & 0xf);
+                    break;
+                case 0x7:
+                    sub_reg_rev(c, hi & 0xf, lo >> 4);
+                    break;
+                case 0xe:
+                    if (q.shift_vy) c->V[hi & 0xf] = c->V[lo >> 4];
+                    shift_reg_left(c, hi & 0xf);
+                    break;
+                default:
+                    raise_trap(c, TRAP_ILLEGAL_OPCODE);
+            }
+            break;
+        case 0x9:
+            skip_not_equal_reg(c, hi & 0xf, lo >> 4);
+            break;
+        case 0xa:
+            set_index_reg(c, full & 0xfff);
+            if (budget >= 2 && next_is(c, 1, 0xd)) return fused_draw(c, q, budget);
+            break;
+        case 0xb:
+            jmp_addr_reg(c, full & 0xfff, q.jump_vx ? hi & 0xf : 0);
+            break;
+        case 0xc:
+            num_gen(c, hi & 0xf, lo);
+            break;
+        case 0xd:
+            draw(c, q, hi & 0xf, lo >> 4, lo & 0xf, budget);
+            break;
+        case 0xe:
+            switch (lo) {
+                case 0x9e:
+                    skip_if_key_pressed(c, hi & 0xf);
+                    break;
+                case 0xa1:
+                    skip_if_key_not_pressed(c, hi & 0xf);
+                    break;
+                default:
+                    raise_trap(c, TRAP_ILLEGAL_OPCODE);
+            }
+            break;
+        case 0xf:
+            switch (lo) {
+                case 0x07:
+                    if (budget >= 3 && next_is(c, 2, 0x3) && c->memory[c->pc] == (0x30 | (hi & 0xf)) &&
+                        (c->memory[c->pc + 2] & 0xf0) == 0x10 &&
+                        ((c->memory[c->pc + 2] & 0xf) << 8 | c->memory[c->pc + 3]) == c->pc - 2) {
+                        return fused_timer_wait(c, hi & 0xf, budget);
+                    }
+                    set_reg_timer(c, hi & 0xf);
+                    break;
+                case 0x0a:
+                    // keys never change within a run_steps() call, so if none is
+                    // released now the rest of the batch spins here
+                    if (budget >= 2 && !(c->keyold & ~c->keycur)) {
+                        c->pc -= 2;
+                        c->cycles += budget - 1;
+                        return budget;
+                    }
+                    wait_for_key(c, hi & 0xf);
+                    break;
+                case 0x15:
+                    set_delay_timer(c, hi & 0xf);
+                    break;
+                case 0x18:
+                    set_sound_timer(c, hi & 0xf);
+                    break;
+                case 0x1e:
+                    add_reg_index(c, hi & 0xf);
+                    break;
+                case 0x29:
+                    get_font_char(c, hi & 0xf);
+                    if (budget >= 2 && next_is(c, 1, 0xd)) return fused_draw(c, q, budget);
+                    break;
+                case 0x33:
+                    bcd(c, hi & 0xf);
+                    break;
+                case 0x55:
+                    store_reg(c, hi & 0xf);
+                    if (q.memory_increment && c->trap == TRAP_NONE) c->I += (hi & 0xf) + 1;
+                    break;
+                case 0x65:
+                    load_reg(c, hi & 0xf);
+                    if (q.memory_increment && c->trap == TRAP_NONE) c->I += (hi & 0xf) + 1;
+                    break;
+                default:
+                    raise_trap(c, TRAP_ILLEGAL_OPCODE);
+            }
+            break;
+        default:
+            raise_trap(c, TRAP_ILLEGAL_OPCODE);
+    }
+    return 1;
+}
+
+static void step_vip(chip_8 *c) {
+    step_with(c, QUIRKS_VIP, 1);
+}
+
+static void step_schip(chip_8 *c) {
+    step_with(c, QUIRKS_SCHIP, 1);
+}
+
+static void step_xochip(chip_8 *c) {
+    step_with(c, QUIRKS_XOCHIP, 1);
+}
+
+// execute one instruction with the machine's own profile. batch runs go through
+// run_steps(), which picks the profile once per batch instead.
+void step(chip_8 *c) {
+    switch (c->profile) {
+        case PROFILE_SCHIP: step_schip(c); break;
+        case PROFILE_XOCHIP: step_xochip(c); break;
+        default: step_vip(c); break;
+    }
+}
+
+// returns false (and leaves the machine as it was) if the file can't be read or doesn't fit
+bool load(chip_8 *c, const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "[!] failed to open the selected file!\n");
+        return false;
+    }
+    // read it whole before touching memory, so a short read changes nothing
+    uint8_t program[MEMORY_SIZE - PRG_ADDR];
+    long size = fseek(fp, 0L, SEEK_END) ? -1 : ftell(fp);
+    if (size < 0 || fseek(fp, 0L, SEEK_SET)) {
+        fprintf(stderr, "[!] failed to read the selected file!\n");
+        fclose(fp);
+        return false;
+    }
+    if (size > (long) sizeof(program)) {
+        fprintf(stderr, "[!] file is too large to be copied\n");
+        fclose(fp);
+        return false;
+    }
+    bool complete = fread(program, 1, size, fp) == (size_t) size;
+    fclose(fp);
+    if (!complete) {
+        fprintf(stderr, "[!] failed to read the selected file!\n");
+        return false;
+    }
+    if (!load_buffer(c, program, size)) return false;
+    printf("[*] loaded ROM\n");
+    return true;
+}
+
+// copy an in-memory ROM image (e.g. an assembled or generated program) to PRG_ADDR
+bool load_buffer(chip_8 *c, const uint8_t *data, long size) {
+    if (size < 0) {
+        fprintf(stderr, "[!] program has a negative size\n");
+        return false;
+    }
+    if (size > MEMORY_SIZE - PRG_ADDR) {
+        fprintf(stderr, "[!] program is too large to be copied\n");
+        return false;
+    }
+    memcpy(c->memory + PRG_ADDR, data, size);
+    c->memory_hash = memory_hash_full(c);
+    return true;
+}
+
+// 60 Hz timer tick, independent of how many instructions run per frame
+void tick_timers(chip_8 *c) {
+    if (c->delay_timer > 0) c->delay_timer--;
+    if (c->sound_timer > 0) c->sound_timer--;
+}
+
+// latch a new keypad state; the previous one is kept for FX0A release detection
+void set_keys(chip_8 *c, uint16_t keys) {
+    c->keyold = c->keycur;
+    c->keycur = keys;
+}
+
+// everything that happens at a 60 Hz frame boundary before instructions run.
+// recorders and replayers go through here so both sides see the same boundary.
+void begin_frame(chip_8 *c, uint16_t keys) {
+    tick_timers(c);
+    set_keys(c, keys);
+}
+
+// the batch loop is instantiated from this body for every profile, twice: the plain
+// version never touches the debugger, the debug version checks breakpoints before and
+// watchpoints after every instruction. run_steps() picks one per batch, so normal
+// runs pay for neither the debugger nor the profile choice.
+static inline __attribute__((always_inline))
+int run_steps_with(chip_8 *c, int n, debugger *dbg, uint32_t *idle, const bool debug, const quirks q) {
+    int steps = 0;
+    while (steps < n && c->running) {
+        uint16_t pc = c->pc;
+        if (!debug) {
+            // of the superinstructions only an FX0A wait is all spins; the others
+            // make progress even when they end where they started
+            int ran = step_with(c, q, n - steps);
+            steps += ran;
+            if (idle && c->pc == pc && (ran == 1 || waiting_for_key(c))) *idle += ran;
+            continue;
+        }
+        if (debug_check_before(dbg, c, steps == 0)) {
+            c->running = false;
+            break;
+        }
+        uint16_t op = opcode_at(c, pc);
+        uint16_t I = c->I;
+        step_with(c, q, 1);
+        steps++;
+        if (idle && c->pc == pc) (*idle)++;
+        // a trap is the reason the machine stopped, whatever the instruction meant to write
+        if (c->trap == TRAP_NONE && debug_check_after(dbg, pc, op, I)) {
+            c->running = false;
+            break;
+        }
+    }
+    return steps;
+}
+
+#define RUN_STEPS_PROFILE(name, profile_quirks) \
+    static int run_steps_##name(chip_8 *c, int n, uint32_t *idle) { \
+        return run_steps_with(c, n, NULL, idle, false, profile_quirks); \
+    } \
+    static int run_steps_##name##_debug(chip_8 *c, int n, debugger *dbg, uint32_t *idle) { \
+        return run_steps_with(c, n, dbg, idle, true, profile_quirks); \
+    }
+
+RUN_STEPS_PROFILE(vip, QUIRKS_VIP)
+RUN_STEPS_PROFILE(schip, QUIRKS_SCHIP)
+RUN_STEPS_PROFILE(xochip, QUIRKS_XOCHIP)
+
+// run up to n instructions, stopping early if the machine stops or a breakpoint hits.
+// dbg and idle may be NULL. returns the number of instructions executed.
+int run_steps(chip_8 *c, int n, debugger *dbg, uint32_t *idle) {
+    // checked once per batch, so the watchdog may overshoot by up to n instructions
+    if (c->watchdog && c->cycles >= c->watchdog && c->running) {
+        trap_at(c, TRAP_WATCHDOG, c->pc);
+        return 0;
+    }
+    bool debug = dbg && dbg->armed;
+    switch (c->profile) {
+        case PROFILE_SCHIP:
+            return debug ? run_steps_schip_debug(c, n, dbg, idle) : run_steps_schip(c, n, idle);
+        case PROFILE_XOCHIP:
+            return debug ? run_steps_xochip_debug(c, n, dbg, idle) : run_steps_xochip(c, n, idle);
+        default:
+            return debug ? run_steps_vip_debug(c, n, dbg, idle) : run_steps_vip(c, n, idle);
+    }
+}
+
+// run_steps() for loops that take many machines in turn: one waiting_for_key() is not
+// dispatched into at all until its next frame, only its cycle count moves as the FX0A
+// spin would have moved it. a due watchdog still goes through run_steps().
+int schedule_steps(chip_8 *c, int n) {
+    if (!waiting_for_key(c) || (c->watchdog && c->cycles >= c->watchdog)) return run_steps(c, n, NULL, NULL);
+    c->cycles += n;
+    return n;
+}
+
+// one host frame worth of emulation without rendering, for headless runs.
+// returns the number of instructions executed.
+int run_frame(chip_8 *c, uint16_t keys) {
+    begin_frame(c, keys);
+    return schedule_steps(c, STEPS_PER_FRAME);
+}
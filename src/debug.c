@@ -0,0 +1,131 @@
+#include <string.h>
+#include <debug.h>
+
+static const char *hit_names[] = {"none", "breakpoint", "condition", "watchpoint"};
+
+static void update_armed(debugger *d) {
+    d->armed = d->breakpoint_count + d->condition_count + d->watch_count;
+}
+
+void debug_reset(debugger *d) {
+    memset(d, 0, sizeof(*d));
+}
+
+void debug_toggle_breakpoint(debugger *d, uint16_t addr) {
+    addr &= 0xfff;
+    uint64_t bit = 1ULL << (addr & 63);
+    d->breakpoints[addr >> 6] ^= bit;
+    d->breakpoint_count += (d->breakpoints[addr >> 6] & bit) ? 1 : -1;
+    update_armed(d);
+}
+
+bool debug_add_condition(debugger *d, uint16_t pc, uint8_t reg, cond_op op, uint8_t value) {
+    if (d->condition_count >= MAX_CONDITIONS || reg > 0xf) return false;
+    d->conditions[d->condition_count++] = (reg_condition) {pc, reg, op, value};
+    update_armed(d);
+    return true;
+}
+
+bool debug_add_watch(debugger *d, uint16_t start, uint16_t end) {
+    if (d->watch_count >= MAX_WATCHPOINTS || start >= end) return false;
+    d->watches[d->watch_count++] = (watch_range) {start, end};
+    update_armed(d);
+    return true;
+}
+
+// add [start, end) as a watchpoint, or remove it if exactly that range is already watched
+bool debug_toggle_watch(debugger *d, uint16_t start, uint16_t end) {
+    for (int i = 0; i < d->watch_count; i++) {
+        if (d->watches[i].start == start && d->watches[i].end == end) {
+            d->watches[i] = d->watches[--d->watch_count];
+            update_armed(d);
+            return false;
+        }
+    }
+    return debug_add_watch(d, start, end);
+}
+
+void debug_clear_conditions(debugger *d) {
+    d->condition_count = 0;
+    update_armed(d);
+}
+
+void debug_clear_watches(debugger *d) {
+    d->watch_count = 0;
+    update_armed(d);
+}
+
+const char *debug_hit_name(hit_kind kind) {
+    return hit_names[kind];
+}
+
+static bool condition_holds(const reg_condition *rc, const chip_8 *c) {
+    uint8_t v = c->V[rc->reg];
+    switch (rc->op) {
+        case COND_EQ: return v == rc->value;
+        case COND_NE: return v != rc->value;
+        case COND_LT: return v < rc->value;
+        case COND_GT: return v > rc->value;
+        default: return false;
+    }
+}
+
+// does a breakpoint or condition stop the machine before the instruction at c->pc?
+hit_kind debug_match_before(const debugger *d, const chip_8 *c) {
+    if (debug_has_breakpoint(d, c->pc)) return HIT_BREAKPOINT;
+    for (int i = 0; i < d->condition_count; i++) {
+        const reg_condition *rc = &d->conditions[i];
+        if ((rc->pc == ANY_PC || rc->pc == c->pc) && condition_holds(rc, c)) return HIT_CONDITION;
+    }
+    return HIT_NONE;
+}
+
+// memory written by `op` when I holds `I`, as [*lo, *hi). only FX33 and FX55 write memory,
+// and one that would run past the end traps without writing anything.
+bool debug_write_span(uint16_t op, uint16_t I, uint16_t *lo, uint16_t *hi) {
+    unsigned end;
+    if ((op & 0xf000) != 0xf000) return false;
+    if ((op & 0xff) == 0x33) {
+        end = I + 3u;
+    } else if ((op & 0xff) == 0x55) {
+        end = I + ((op >> 8) & 0xf) + 1u;
+    } else {
+        return false;
+    }
+    *lo = I;
+    *hi = end;
+    return end <= MEMORY_SIZE;
+}
+
+// first watched address in [lo, hi), or -1
+int debug_match_write(const debugger *d, uint16_t lo, uint16_t hi) {
+    for (int i = 0; i < d->watch_count; i++) {
+        const watch_range *w = &d->watches[i];
+        if (lo < w->end && w->start < hi) return lo > w->start ? lo : w->start;
+    }
+    return -1;
+}
+
+// called before executing the instruction at c->pc. `resuming` is set for the
+// first instruction of a batch, so continuing from a stop doesn't re-trigger it.
+bool debug_check_before(debugger *d, const chip_8 *c, bool resuming) {
+    if (resuming && d->hit != HIT_NONE && d->hit_pc == c->pc) {
+        d->hit = HIT_NONE;
+        return false;
+    }
+    d->hit = debug_match_before(d, c);
+    d->hit_pc = c->pc;
+    return d->hit != HIT_NONE;
+}
+
+// called after executing `op` at `pc`, with I as it was before the instruction
+bool debug_check_after(debugger *d, uint16_t pc, uint16_t op, uint16_t I) {
+    uint16_t lo, hi;
+    if (d->watch_count == 0 || !debug_write_span(op, I, &lo, &hi)) return false;
+    int addr = debug_match_write(d, lo, hi);
+    if (addr < 0) return false;
+    d->hit = HIT_WATCHPOINT;
+    d->hit_pc = pc;
+    d->hit_addr = addr;
+    return true;
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <debugview.h>
+#include <disasm.h>
+#include <cpu.h>
+#include <raygui.h>
+
+#define ROW_HEIGHT 16
+#define FONT_SIZE 10
+
+void debug_view_init(debug_view *v) {
+    memset(v, 0, sizeof(*v));
+    v->code_top = PRG_ADDR;
+    v->mem_top = PRG_ADDR;
+    v->follow_pc = true;
+}
+
+static bool watched(const debugger *d, uint16_t start, uint16_t end) {
+    for (int i = 0; i < d->watch_count; i++) {
+        if (start < d->watches[i].end && d->watches[i].start < end) return true;
+    }
+    return false;
+}
+
+// only the visible window is looked at, and a row is formatted again only if its opcode changed
+static void update_code_rows(debug_view *v, const chip_8 *c) {
+    for (int i = 0; i < DEBUG_ROWS; i++) {
+        disasm_row *r = &v->code[i];
+        uint16_t addr = v->code_top + i * 2;
+        if (addr + 1 >= MEMORY_SIZE) {
+            r->valid = false;
+            continue;
+        }
+        uint16_t op = (c->memory[addr] << 8) | c->memory[addr + 1];
+        uint8_t flags = v->flow ? v->flow->flags[addr] : CFG_CODE;
+        if (r->valid && r->addr == addr && r->op == op && r->flags == flags && r->profile == c->profile) continue;
+        r->valid = true;
+        r->addr = addr;
+        r->op = op;
+        r->flags = flags;
+        r->profile = c->profile;
+        char text[24];
+        if ((flags & CFG_DATA) && !(flags & CFG_CODE)) {
+            snprintf(text, sizeof(text), "DB 0x%02X, 0x%02X", op >> 8, op & 0xff);
+        } else {
+            disasm(op, profile_quirks(c->profile), text, sizeof(text));
+        }
+        snprintf(r->text, sizeof(r->text), "%03X %04X %s", addr, op, text);
+        v->reformatted++;
+    }
+}
+
+static void update_mem_rows(debug_view *v, const chip_8 *c) {
+    for (int i = 0; i < DEBUG_ROWS; i++) {
+        mem_row *r = &v->mem[i];
+        uint16_t addr = v->mem_top + i * MEM_ROW_BYTES;
+        if (addr + MEM_ROW_BYTES > MEMORY_SIZE) {
+            r->valid = false;
+            continue;
+        }
+        const uint8_t *bytes = &c->memory[addr];
+        if (r->valid && r->addr == addr && !memcmp(r->bytes, bytes, MEM_ROW_BYTES)) continue;
+        r->valid = true;
+        r->addr = addr;
+        memcpy(r->bytes, bytes, MEM_ROW_BYTES);
+        snprintf(r->text, sizeof(r->text), "%03X %02X %02X %02X %02X %02X %02X %02X %02X", addr,
+                 bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5], bytes[6], bytes[7]);
+        v->reformatted++;
+    }
+}
+
+static uint16_t scroll(uint16_t top, float wheel, int stride, int limit) {
+    int next = top - (int) wheel * stride * 2;
+    if (next < 0) next = 0;
+    if (next > limit) next = limit;
+    return next;
+}
+
+// debugger window: disassembly (click toggles a breakpoint), memory (click toggles a
+// write watch on the row, right click asks who last wrote it), registers and the
+// reason for the last stop.
+debug_action draw_debug_view(debug_view *v, const chip_8 *c, debugger *d, Rectangle bounds) {
+    Rectangle code = {bounds.x + 4, bounds.y + 28, 136, DEBUG_ROWS * ROW_HEIGHT};
+    Rectangle mem = {bounds.x + 144, bounds.y + 28, bounds.width - 148, DEBUG_ROWS * ROW_HEIGHT};
+    Vector2 mouse = GetMousePosition();
+    float wheel = GetMouseWheelMove();
+
+    if (wheel != 0 && CheckCollisionPointRec(mouse, code)) {
+        v->follow_pc = false;
+        v->code_top = scroll(v->code_top, wheel, 2, MEMORY_SIZE - DEBUG_ROWS * 2);
+    } else if (wheel != 0 && CheckCollisionPointRec(mouse, mem)) {
+        v->mem_top = scroll(v->mem_top, wheel, MEM_ROW_BYTES, MEMORY_SIZE - DEBUG_ROWS * MEM_ROW_BYTES);
+    }
+    if (v->follow_pc && (c->pc < v->code_top || c->pc >= v->code_top + DEBUG_ROWS * 2)) {
+        v->code_top = c->pc >= 8 ? c->pc - 8 : 0;
+    }
+
+    v->reformatted = 0;
+    update_code_rows(v, c);
+    update_mem_rows(v, c);
+
+    debug_action action = DEBUG_ACTION_NONE;
+    bool clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    bool queried = IsMouseButtonPressed(MOUSE_BUTTON_RIGHT);
+    for (int i = 0; i < DEBUG_ROWS; i++) {
+        const disasm_row *r = &v->code[i];
+        if (!r->valid) continue;
+        Rectangle row = {code.x, code.y + i * ROW_HEIGHT, code.width, ROW_HEIGHT};
+        if (clicked && CheckCollisionPointRec(mouse, row)) debug_toggle_breakpoint(d, r->addr);
+        if (r->addr == c->pc) DrawRectangleRec(row, Fade(SKYBLUE, 0.5f));
+        if (debug_has_breakpoint(d, r->addr)) DrawRectangle(row.x, row.y + 4, 6, 6, RED);
+        // subroutines and loop heads get a bar, bytes never reached as code are greyed
+        if (r->flags & CFG_CALL_TARGET) DrawRectangle(row.x + row.width - 3, row.y, 3, ROW_HEIGHT, DARKBLUE);
+        if (r->flags & CFG_LOOP_HEAD) DrawRectangle(row.x + row.width - 6, row.y, 3, ROW_HEIGHT, ORANGE);
+        DrawText(r->text, row.x + 8, row.y + 3, FONT_SIZE, r->flags & CFG_CODE ? DARKGRAY : GRAY);
+    }
+    for (int i = 0; i < DEBUG_ROWS; i++) {
+        const mem_row *r = &v->mem[i];
+        if (!r->valid) continue;
+        Rectangle row = {mem.x, mem.y + i * ROW_HEIGHT, mem.width, ROW_HEIGHT};
+        if (clicked && CheckCollisionPointRec(mouse, row)) debug_toggle_watch(d, r->addr, r->addr + MEM_ROW_BYTES);
+        if (queried && CheckCollisionPointRec(mouse, row)) {
+            v->query_start = r->addr;
+            v->query_end = r->addr + MEM_ROW_BYTES;
+            action = DEBUG_ACTION_LAST_WRITE;
+        }
+        if (watched(d, r->addr, r->addr + MEM_ROW_BYTES)) DrawRectangleRec(row, Fade(ORANGE, 0.4f));
+        DrawText(r->text, row.x + 2, row.y + 3, FONT_SIZE, DARKGRAY);
+    }
+
+    float y = code.y + code.height + 4;
+    DrawText(TextFormat("PC %03X  I %03X  SP %X  DT %02X  ST %02X", c->pc, c->I, c->sp, c->delay_timer,
+                        c->sound_timer), bounds.x + 8, y, FONT_SIZE, DARKGRAY);
+    DrawText(TextFormat("V0-7 %02X %02X %02X %02X %02X %02X %02X %02X", c->V[0], c->V[1], c->V[2], c->V[3],
+                        c->V[4], c->V[5], c->V[6], c->V[7]), bounds.x + 8, y + 12, FONT_SIZE, DARKGRAY);
+    DrawText(TextFormat("V8-F %02X %02X %02X %02X %02X %02X %02X %02X", c->V[8], c->V[9], c->V[10], c->V[11],
+                        c->V[12], c->V[13], c->V[14], c->V[15]), bounds.x + 8, y + 24, FONT_SIZE, DARKGRAY);
+    if (c->trap != TRAP_NONE) {
+        DrawText(TextFormat("trapped: %s at %03X", trap_name(c->trap), c->trap_pc), bounds.x + 8, y + 36, FONT_SIZE,
+                 MAROON);
+    } else if (d->hit != HIT_NONE) {
+        const char *status = d->hit == HIT_WATCHPOINT
+                             ? TextFormat("stopped: watchpoint at %03X wrote %03X", d->hit_pc, d->hit_addr)
+                             : TextFormat("stopped: %s at %03X", debug_hit_name(d->hit), d->hit_pc);
+        DrawText(status, bounds.x + 8, y + 36, FONT_SIZE, MAROON);
+    }
+    if (v->message[0]) DrawText(v->message, bounds.x + 8, y + 48, FONT_SIZE, DARKGRAY);
+    v->follow_pc = GuiCheckBox((Rectangle) {bounds.x + bounds.width - 70, y + 36, 10, 10}, "follow", v->follow_pc);
+    if (GuiButton((Rectangle) {bounds.x + bounds.width - 28, bounds.y + 28 + DEBUG_ROWS * ROW_HEIGHT + 4, 24, 24},
+                  GuiIconText(ICON_PLAYER_PREVIOUS, NULL))) {
+        action = DEBUG_ACTION_REVERSE_CONTINUE;
+    }
+    return action;
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <detect.h>
+#include <cpu.h>
+#include <trace.h>
+
+// quirk detection: the same ROM runs under every profile on its own thread with the
+// same scripted input. profiles that trap, or whose screen freezes while the others
+// keep going, lose; where the runs can't tell profiles apart, static hints from the
+// code decide; with no evidence at all the VIP default stays.
+
+#define TRAP_PENALTY 100
+#define STALL_PENALTY 10
+
+// the oldest instruction set that has `op`
+static quirk_profile opcode_platform(uint16_t op) {
+    if (op == 0x00fb || op == 0x00fc || op == 0x00fd || op == 0x00fe || op == 0x00ff ||
+        (op & 0xfff0) == 0x00c0 || (op & 0xf0ff) == 0xf030 || (op & 0xf0ff) == 0xf075 ||
+        (op & 0xf0ff) == 0xf085) {
+        return PROFILE_SCHIP;
+    }
+    if (op == 0xf000 || op == 0xf002 || (op & 0xf00f) == 0x5002 || (op & 0xf00f) == 0x5003 ||
+        (op & 0xf0ff) == 0xf001 || (op & 0xf0ff) == 0xf03a || (op & 0xfff0) == 0x00d0) {
+        return PROFILE_XOCHIP;
+    }
+    return PROFILE_VIP;
+}
+
+// a ROM's quirk-sensitive instruction patterns, counted only at offsets some run
+// actually executed (`executed` has one bit per ROM byte) so sprite data doesn't
+// pass for code. these are only nudges; any dynamic difference outweighs them.
+void detect_hints(const uint8_t *rom, long size, const uint64_t *executed, int hints[PROFILE_COUNT]) {
+    memset(hints, 0, PROFILE_COUNT * sizeof(int));
+    for (long i = 0; i + 1 < size; i++) {
+        if (!(executed[i / 64] >> (i % 64) & 1)) continue;
+        uint16_t op = (rom[i] << 8) | rom[i + 1];
+        uint8_t x = (op >> 8) & 0xf, y = (op >> 4) & 0xf, n = op & 0xf;
+        quirk_profile platform = opcode_platform(op);
+        if (platform == PROFILE_SCHIP) {
+            // SUPER-CHIP instructions, which XO-CHIP also has
+            hints[PROFILE_SCHIP] += 2;
+            hints[PROFILE_XOCHIP] += 1;
+        } else if (platform == PROFILE_XOCHIP) {
+            hints[PROFILE_XOCHIP] += 3;
+        } else if ((op & 0xf000) == 0x8000 && (n == 0x6 || n == 0xe) && x != y) {
+            // "SHR VX" from SUPER-CHIP era assemblers leaves Y zero; a named source means Vy is meant
+            hints[y == 0 ? PROFILE_SCHIP : PROFILE_VIP]++;
+            if (y != 0) hints[PROFILE_XOCHIP]++;
+        } else if ((op & 0xf0ff) == 0xf055 || (op & 0xf0ff) == 0xf065) {
+            // look at what the following code does with I before setting it again
+            for (long j = i + 2; j + 1 < size && j <= i + 8; j += 2) {
+                uint16_t next = (rom[j] << 8) | rom[j + 1];
+                if ((next & 0xf000) == 0xa000 || (next & 0xf0ff) == 0xf029) break;
+                if ((next & 0xf0ff) == 0xf01e || ((op & 0xf0ff) == 0xf055 && (next & 0xf0ff) == 0xf065)) {
+                    // stepping I by hand, or reading back what was just stored: I is assumed unchanged
+                    hints[PROFILE_SCHIP]++;
+                    break;
+                }
+                if ((next & 0xf0ff) == (op & 0xf0ff)) {
+                    // consecutive blocks without touching I: I is assumed to have moved on
+                    hints[PROFILE_VIP]++;
+                    hints[PROFILE_XOCHIP]++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// the scripted input every profile sees: a second of nothing for the title screen,
+// then each key in turn, pressed for 6 frames out of every 20
+uint16_t detect_keys(long frame) {
+    if (frame < 60) return 0;
+    long window = (frame - 60) / 20;
+    return (frame - 60) % 20 < 6 ? 1 << (window % 16) : 0;
+}
+
+static uint64_t display_hash(const chip_8 *c) {
+    const uint8_t *p = &c->display[0][0];
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < sizeof(c->display); i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+typedef struct {
+    const uint8_t *rom;
+    long size;
+    long frames;
+    quirk_profile profile;
+    uint64_t *hashes;   // one per frame
+    uint64_t *executed; // ROM offsets this run fetched an instruction from
+    profile_run *run;
+    bool failed; // no machine to run it on
+} detect_job;
+
+static void detect_run(detect_job *job) {
+    chip_8 *c = chip_alloc();
+    if (!c) {
+        job->failed = true;
+        return;
+    }
+    init(c);
+    load_buffer(c, job->rom, job->size);
+    c->profile = job->profile;
+    c->running = true;
+    job->run->trap = TRAP_NONE;
+    job->run->trap_frame = -1;
+    TRACE_BEGIN("detect");
+    for (long f = 0; f < job->frames; f++) {
+        if (c->running) {
+            // single steps rather than run_frame(), to see every pc
+            begin_frame(c, detect_keys(f));
+            for (int i = 0; i < STEPS_PER_FRAME && c->running; i++) {
+                unsigned offset = c->pc - PRG_ADDR;
+                if (offset < MEMORY_SIZE - PRG_ADDR) job->executed[offset / 64] |= 1ull << (offset % 64);
+                step(c);
+            }
+            if (c->trap != TRAP_NONE && job->run->trap_frame < 0) {
+                job->run->trap = c->trap;
+                job->run->trap_frame = f;
+            }
+        }
+        job->hashes[f] = display_hash(c);
+    }
+    TRACE_END("detect");
+    job->run->last_hash = job->hashes[job->frames - 1];
+    free(c);
+}
+
+static void *detect_thread(void *arg) {
+    detect_job *job = arg;
+    trace_set_thread_name(profile_name(job->profile));
+    detect_run(job);
+    return NULL;
+}
+
+// true if the screen changed at all during the second half of the run
+static bool changes_late(const uint64_t *hashes, long frames) {
+    for (long f = frames / 2 + 1; f < frames; f++) {
+        if (hashes[f] != hashes[f - 1]) return true;
+    }
+    return false;
+}
+
+bool detect_profile(const uint8_t *rom, long size, long frames, detect_result *out) {
+    if (frames < 2) frames = 2;
+    memset(out, 0, sizeof(*out));
+    uint64_t *hashes = malloc(PROFILE_COUNT * frames * sizeof(uint64_t));
+    if (!hashes) {
+        fprintf(stderr, "[!] failed to allocate detection buffers\n");
+        return false;
+    }
+    uint64_t executed[PROFILE_COUNT][MEMORY_SIZE / 64] = {0};
+
+    detect_job jobs[PROFILE_COUNT];
+    pthread_t threads[PROFILE_COUNT];
+    bool started[PROFILE_COUNT];
+    for (int p = 0; p < PROFILE_COUNT; p++) {
+        jobs[p] = (detect_job) {rom, size, frames, p, hashes + p * frames, executed[p], &out->runs[p], false};
+        started[p] = pthread_create(&threads[p], NULL, detect_thread, &jobs[p]) == 0;
+        // no thread to spare: run it here, under the caller's own thread name
+        if (!started[p]) detect_run(&jobs[p]);
+    }
+    bool failed = false;
+    for (int p = 0; p < PROFILE_COUNT; p++) {
+        if (started[p]) pthread_join(threads[p], NULL);
+        failed |= jobs[p].failed;
+    }
+    // a profile that never ran has no hashes to score
+    if (failed) {
+        fprintf(stderr, "[!] failed to allocate a machine for detection\n");
+        free(hashes);
+        return false;
+    }
+    for (int p = 1; p < PROFILE_COUNT; p++) {
+        for (int i = 0; i < MEMORY_SIZE / 64; i++) {
+            executed[0][i] |= executed[p][i];
+        }
+    }
+    int hints[PROFILE_COUNT];
+    detect_hints(rom, size, executed[0], hints);
+    out->platform = PROFILE_VIP;
+    for (long i = 0; i + 1 < size; i++) {
+        if (!(executed[0][i / 64] >> (i % 64) & 1)) continue;
+        quirk_profile platform = opcode_platform((rom[i] << 8) | rom[i + 1]);
+        if (platform > out->platform) out->platform = platform;
+    }
+
+    out->diverged_frame = -1;
+    for (long f = 0; f < frames && out->diverged_frame < 0; f++) {
+        for (int p = 1; p < PROFILE_COUNT; p++) {
+            if (hashes[p * frames + f] != hashes[f]) {
+                out->diverged_frame = f;
+                break;
+            }
+        }
+    }
+    bool any_late = false;
+    for (int p = 0; p < PROFILE_COUNT; p++) {
+        any_late |= changes_late(hashes + p * frames, frames);
+    }
+
+    bool any_trap = false, any_hint = false;
+    for (int p = 0; p < PROFILE_COUNT; p++) {
+        profile_run *run = &out->runs[p];
+        run->hint = hints[p];
+        run->stalled = out->diverged_frame >= 0 && any_late && !changes_late(hashes + p * frames, frames);
+        run->score = run->hint;
+        if (run->trap != TRAP_NONE) {
+            // a later trap is less damning than an early one
+            run->score -= TRAP_PENALTY + (int) ((frames - run->trap_frame) * TRAP_PENALTY / frames);
+            any_trap = true;
+        }
+        if (run->stalled) run->score -= STALL_PENALTY;
+        any_hint |= hints[p] != hints[0];
+    }
+    // ties go to the lower profile, so VIP wins when there's no evidence either way
+    out->best = PROFILE_VIP;
+    for (int p = 1; p < PROFILE_COUNT; p++) {
+        if (out->runs[p].score > out->runs[out->best].score) out->best = p;
+    }
+    out->agnostic = out->diverged_frame < 0 && !any_trap && !any_hint;
+    free(hashes);
+    return true;
+}
+
+bool rom_sha1_file(const char *path, uint8_t digest[SHA1_SIZE]) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    uint8_t data[MEMORY_SIZE];
+    size_t size = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+    sha1(data, size, digest);
+    return true;
+}
+
+bool quirkdb_lookup(const char *db, const char *hex, quirk_profile *out) {
+    FILE *fp = fopen(db, "r");
+    if (!fp) return false;
+    char line[512];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), fp)) {
+        char key[SHA1_HEX_SIZE], name[16];
+        if (line[0] == '#' || sscanf(line, "%40s %15s", key, name) != 2) continue;
+        found = !strcmp(key, hex) && profile_parse(name, out);
+    }
+    fclose(fp);
+    return found;
+}
+
+// replace the entry for `hex` (or add one). the file is rewritten next to the old one
+// and renamed over it, so an interrupted batch never leaves a truncated database.
+bool quirkdb_store(const char *db, const char *hex, quirk_profile profile, const char *name) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", db);
+    FILE *out = fopen(tmp, "w");
+    if (!out) {
+        fprintf(stderr, "[!] failed to open %s for writing\n", tmp);
+        return false;
+    }
+    FILE *in = fopen(db, "r");
+    if (in) {
+        char line[512];
+        while (fgets(line, sizeof(line), in)) {
+            if (!strncmp(line, hex, SHA1_HEX_SIZE - 1) && line[SHA1_HEX_SIZE - 1] == ' ') continue;
+            fputs(line, out);
+        }
+        fclose(in);
+    } else {
+        fprintf(out, "# sha1 profile rom\n");
+    }
+    fprintf(out, "%s %s %s\n", hex, profile_name(profile), name);
+    bool ok = fclose(out) == 0 && rename(tmp, db) == 0;
+    if (!ok) fprintf(stderr, "[!] failed to update %s\n", db);
+    return ok;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <diffcheck.h>
+#include <cpu.h>
+#include <debug.h>
+#include <disasm.h>
+
+// lockstep differential checking. the reference and a candidate engine run the same
+// ROM and input side by side. the candidate runs with the budgets a frontend gives it,
+// so its superinstructions and other batch-only paths are what gets checked, and the
+// reference catches up to it after every call; the machines are compared at the first
+// return after every `interval` instructions. a mismatch only says the engines parted
+// somewhere since the last comparison, so both are re-run from that point, compared
+// after every call, to find the first instruction they disagree on.
+
+static int run_reference(chip_8 *c, int n) {
+    int steps = 0;
+    while (steps < n && c->running) {
+        step(c);
+        steps++;
+    }
+    return steps;
+}
+
+static int run_batch(chip_8 *c, int n) {
+    return run_steps(c, n, NULL, NULL);
+}
+
+// a condition that never holds arms the debugger without ever stopping it
+static int run_debug(chip_8 *c, int n) {
+    static _Thread_local debugger dbg;
+    if (!dbg.armed) debug_add_condition(&dbg, ANY_PC, 0, COND_LT, 0);
+    return run_steps(c, n, &dbg, NULL);
+}
+
+const engine engines[] = {
+    {"step", run_reference, "step() per instruction, the reference"},
+    {"batch", run_batch, "run_steps(), one quirk instantiation per batch"},
+    {"debug", run_debug, "run_steps() with an armed debugger"},
+};
+const int engine_count = sizeof(engines) / sizeof(engines[0]);
+
+// run_steps() with a bug planted in one superinstruction: a fused pair of 6XNN loads
+// leaves the second register one off. it is only wrong when one call runs both loads,
+// which no comparison after every single instruction would ever see.
+static int run_planted(chip_8 *c, int n) {
+    int steps = 0;
+    while (steps < n && c->running) {
+        uint16_t first = opcode_at(c, c->pc), second = opcode_at(c, c->pc + 2);
+        bool pair = n - steps >= 2 && first >> 12 == 0x6 && second >> 12 == 0x6;
+        int ran = run_steps(c, pair ? 2 : 1, NULL, NULL);
+        if (pair && ran == 2) c->V[second >> 8 & 0xf]++;
+        steps += ran;
+    }
+    return steps;
+}
+
+const engine diff_planted = {"planted", run_planted, "run_steps() with a planted bug in fused 6XNN pairs"};
+
+const engine *engine_find(const char *name) {
+    for (int i = 0; i < engine_count; i++) {
+        if (!strcmp(engines[i].name, name)) return &engines[i];
+    }
+    return NULL;
+}
+
+static bool same_machine(const chip_8 *a, const chip_8 *b) {
+    return a->pc == b->pc && a->I == b->I && a->sp == b->sp && a->cycles == b->cycles &&
+           a->delay_timer == b->delay_timer && a->sound_timer == b->sound_timer && a->rng == b->rng &&
+           a->running == b->running && a->trap == b->trap && a->trap_pc == b->trap_pc &&
+           a->memory_hash == b->memory_hash && a->display_hash == b->display_hash &&
+           !memcmp(a->V, b->V, sizeof(a->V)) && !memcmp(a->stack, b->stack, sizeof(a->stack)) &&
+           a->keycur == b->keycur && a->keyold == b->keyold &&
+           !memcmp(a->memory, b->memory, MEMORY_SIZE) && !memcmp(a->display, b->display, sizeof(a->display));
+}
+
+#define APPEND(...) \
+    do { \
+        if (n < size) n += snprintf(out + n, size - n, __VA_ARGS__); \
+    } while (0)
+
+// describe how `actual` differs from `expected`, one field per line. returns the
+// number of differing fields.
+int diff_format(const chip_8 *expected, const chip_8 *actual, char *out, int size) {
+    int n = 0, fields = 0;
+    out[0] = 0;
+#define FIELD(name, field, fmt) \
+    if (expected->field != actual->field) { \
+        APPEND("  " name " " fmt " != " fmt "\n", (unsigned long long) expected->field, \
+               (unsigned long long) actual->field); \
+        fields++; \
+    }
+    FIELD("pc", pc, "%03llX")
+    FIELD("I", I, "%03llX")
+    FIELD("sp", sp, "%llu")
+    FIELD("delay", delay_timer, "%llu")
+    FIELD("sound", sound_timer, "%llu")
+    FIELD("rng", rng, "%08llx")
+    FIELD("cycles", cycles, "%llu")
+    FIELD("running", running, "%llu")
+    FIELD("trap", trap, "%llu")
+    FIELD("trap pc", trap_pc, "%03llX")
+    FIELD("memory hash", memory_hash, "%016llx")
+    FIELD("display hash", display_hash, "%016llx")
+#undef FIELD
+    for (int i = 0; i < 16; i++) {
+        if (expected->V[i] != actual->V[i]) {
+            APPEND("  V%X %02X != %02X\n", i, expected->V[i], actual->V[i]);
+            fields++;
+        }
+    }
+    for (int i = 0; i < STACK_SIZE; i++) {
+        if (expected->stack[i] != actual->stack[i]) {
+            APPEND("  stack[%d] %03X != %03X\n", i, expected->stack[i], actual->stack[i]);
+            fields++;
+        }
+    }
+    if (expected->keycur != actual->keycur || expected->keyold != actual->keyold) {
+        APPEND("  keypad latches differ\n");
+        fields++;
+    }
+    int bytes = 0;
+    for (int a = 0; a < MEMORY_SIZE; a++) {
+        if (expected->memory[a] == actual->memory[a]) continue;
+        if (bytes++ < 8) APPEND("  memory[%03X] %02X != %02X\n", a, expected->memory[a], actual->memory[a]);
+    }
+    if (bytes > 8) APPEND("  ... %d bytes of memory in all\n", bytes);
+    fields += bytes;
+    int pixels = 0;
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            pixels += expected->display[x][y] != actual->display[x][y];
+        }
+    }
+    if (pixels) APPEND("  %d pixels differ\n", pixels);
+    return fields + pixels;
+}
+
+// run the candidate for up to `budget` instructions from `from`, the reference for as
+// many as it ran, and say whether the two machines differ
+static bool diverges(const engine *candidate, const chip_8 *from, int budget, chip_8 *expected, chip_8 *actual) {
+    *expected = *from;
+    *actual = *from;
+    engines[0].run(expected, candidate->run(actual, budget));
+    return !same_machine(expected, actual);
+}
+
+// replay both engines from an agreed machine, `done` instructions into `frame`, with
+// the candidate given the same budgets as before and compared after every call. the
+// first call they disagree on is narrowed to the shortest run the candidate gets
+// wrong: its end is the fewest instructions from the start of the call that go wrong,
+// its start the latest point from which one call still goes wrong, so a faulty
+// superinstruction is reported at its first instruction.
+static void locate(const engine *candidate, diff_job *job, const chip_8 *agreed, uint32_t frame, int done) {
+    static _Thread_local chip_8 expected, actual, before, at;
+    expected = *agreed;
+    actual = *agreed;
+    for (; frame < job->frames; frame++, done = 0) {
+        if (!done) {
+            begin_frame(&expected, job->keys[frame]);
+            begin_frame(&actual, job->keys[frame]);
+        }
+        while (done < job->steps_per_frame && (expected.running || actual.running)) {
+            int budget = job->steps_per_frame - done;
+            before = expected;
+            int ran = candidate->run(&actual, budget);
+            engines[0].run(&expected, ran);
+            if (same_machine(&expected, &actual)) {
+                done += ran;
+                if (ran < budget) break;
+                continue;
+            }
+            int end = 1;
+            while (end < budget && !diverges(candidate, &before, end, &expected, &actual)) end++;
+            int start = end;
+            do {
+                start--;
+                at = before;
+                engines[0].run(&at, start);
+            } while (!diverges(candidate, &at, end - start, &expected, &actual) && start > 0);
+            job->diverged = true;
+            job->instructions = at.cycles;
+            job->pc = at.pc;
+            job->op = opcode_at(&at, at.pc);
+            char text[24];
+            disasm(job->op, profile_quirks(at.profile), text, sizeof(text));
+            int n = snprintf(job->report, sizeof(job->report), "frame %u, after %llu instructions: %03X %s\n",
+                             frame, (unsigned long long) at.cycles, job->pc, text);
+            if (end - start > 1 && n < (int) sizeof(job->report)) {
+                n += snprintf(job->report + n, sizeof(job->report) - n,
+                              "  wrong only when the candidate runs %d instructions from here in one call\n",
+                              end - start);
+            }
+            if (n < (int) sizeof(job->report)) {
+                diff_format(&expected, &actual, job->report + n, (int) sizeof(job->report) - n);
+            }
+            return;
+        }
+    }
+    // the coarse comparison saw something this pass could not reproduce
+    job->diverged = true;
+    snprintf(job->report, sizeof(job->report), "diverged, but not when re-run call by call\n");
+}
+
+// check `candidate` against the reference on one job. returns false if they diverged,
+// with the first divergent instruction and a state diff in the job.
+bool diff_run(const engine *candidate, diff_job *job, int interval) {
+    static _Thread_local chip_8 expected, actual, agreed;
+    expected = job->start;
+    actual = job->start;
+    agreed = job->start;
+    uint32_t agreed_frame = 0;
+    int agreed_done = 0, since = 0;
+    job->diverged = false;
+    job->report[0] = 0;
+    if (interval < 1) interval = 1;
+    for (uint32_t f = 0; f < job->frames && (expected.running || actual.running); f++) {
+        begin_frame(&expected, job->keys[f]);
+        begin_frame(&actual, job->keys[f]);
+        for (int done = 0; done < job->steps_per_frame;) {
+            // the candidate gets the rest of the frame, as a frontend would give it, and
+            // the reference follows it one instruction at a time
+            int budget = job->steps_per_frame - done;
+            int ran = candidate->run(&actual, budget);
+            engines[0].run(&expected, ran);
+            done += ran;
+            since += ran;
+            if (since < interval && ran == budget) continue;
+            since = 0;
+            if (!same_machine(&expected, &actual)) {
+                locate(candidate, job, &agreed, agreed_frame, agreed_done);
+                return false;
+            }
+            // stopped, unless a reference still running says otherwise at the end
+            if (ran < budget) break;
+            agreed = expected;
+            agreed_frame = f;
+            agreed_done = done;
+        }
+    }
+    if (!same_machine(&expected, &actual)) {
+        locate(candidate, job, &agreed, agreed_frame, agreed_done);
+        return false;
+    }
+    job->instructions = expected.cycles - job->start.cycles;
+    return true;
+}
+
+typedef struct {
+    const engine *candidate;
+    diff_job *jobs;
+    int count;
+    int interval;
+    atomic_int next;
+    atomic_int failed;
+} diff_batch_job;
+
+static void *diff_thread(void *arg) {
+    diff_batch_job *b = arg;
+    int i;
+    while ((i = atomic_fetch_add(&b->next, 1)) < b->count) {
+        if (!diff_run(b->candidate, &b->jobs[i], b->interval)) atomic_fetch_add(&b->failed, 1);
+    }
+    return NULL;
+}
+
+// check every job, spread over `threads` threads. returns how many diverged.
+int diff_batch(const engine *candidate, diff_job *jobs, int count, int interval, int threads) {
+    diff_batch_job b = {.candidate = candidate, .jobs = jobs, .count = count, .interval = interval};
+    atomic_init(&b.next, 0);
+    atomic_init(&b.failed, 0);
+    pthread_t workers[64];
+    int started = 0;
+    while (started < threads && started < 64 && pthread_create(&workers[started], NULL, diff_thread, &b) == 0) {
+        started++;
+    }
+    // no threads at all still gets the work done
+    if (!started) diff_thread(&b);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    return atomic_load(&b.failed);
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <disasm.h>
+
+// render one opcode in the usual CHIP-8 mnemonics, e.g. "DRW V0, V1, 5". the quirks
+// decide what BNNN means.
+void disasm(uint16_t op, quirks q, char *buf, size_t size) {
+    unsigned x = (op >> 8) & 0xf;
+    unsigned y = (op >> 4) & 0xf;
+    unsigned n = op & 0xf;
+    unsigned nn = op & 0xff;
+    unsigned nnn = op & 0xfff;
+    switch (op >> 12) {
+        case 0x0:
+            if (op == 0x00E0) {
+                snprintf(buf, size, "CLS");
+            } else if (op == 0x00EE) {
+                snprintf(buf, size, "RET");
+            } else {
+                snprintf(buf, size, "SYS 0x%03X", nnn);
+            }
+            return;
+        case 0x1: snprintf(buf, size, "JP 0x%03X", nnn); return;
+        case 0x2: snprintf(buf, size, "CALL 0x%03X", nnn); return;
+        case 0x3: snprintf(buf, size, "SE V%X, 0x%02X", x, nn); return;
+        case 0x4: snprintf(buf, size, "SNE V%X, 0x%02X", x, nn); return;
+        case 0x5: snprintf(buf, size, "SE V%X, V%X", x, y); return;
+        case 0x6: snprintf(buf, size, "LD V%X, 0x%02X", x, nn); return;
+        case 0x7: snprintf(buf, size, "ADD V%X, 0x%02X", x, nn); return;
+        case 0x8: {
+            static const char *alu[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                          NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL};
+            if (alu[n]) {
+                snprintf(buf, size, "%s V%X, V%X", alu[n], x, y);
+                return;
+            }
+            break;
+        }
+        case 0x9: snprintf(buf, size, "SNE V%X, V%X", x, y); return;
+        case 0xa: snprintf(buf, size, "LD I, 0x%03X", nnn); return;
+        case 0xb:
+            if (q.jump_vx) {
+                snprintf(buf, size, "JP V%X, 0x%03X", x, nnn);
+            } else {
+                snprintf(buf, size, "JP V0, 0x%03X", nnn);
+            }
+            return;
+        case 0xc: snprintf(buf, size, "RND V%X, 0x%02X", x, nn); return;
+        case 0xd: snprintf(buf, size, "DRW V%X, V%X, %u", x, y, n); return;
+        case 0xe:
+            if (nn == 0x9e) {
+                snprintf(buf, size, "SKP V%X", x);
+                return;
+            }
+            if (nn == 0xa1) {
+                snprintf(buf, size, "SKNP V%X", x);
+                return;
+            }
+            break;
+        case 0xf:
+            switch (nn) {
+                case 0x07: snprintf(buf, size, "LD V%X, DT", x); return;
+                case 0x0a: snprintf(buf, size, "LD V%X, K", x); return;
+                case 0x15: snprintf(buf, size, "LD DT, V%X", x); return;
+                case 0x18: snprintf(buf, size, "LD ST, V%X", x); return;
+                case 0x1e: snprintf(buf, size, "ADD I, V%X", x); return;
+                case 0x29: snprintf(buf, size, "LD F, V%X", x); return;
+                case 0x33: snprintf(buf, size, "LD B, V%X", x); return;
+                case 0x55: snprintf(buf, size, "LD [I], V%X", x); return;
+                case 0x65: snprintf(buf, size, "LD V%X, [I]", x); return;
+            }
+            break;
+    }
+    snprintf(buf, size, "DW 0x%04X", op);
+}
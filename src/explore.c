@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <explore.h>
+#include <cpu.h>
+#include <perf.h>
+#include <statehash.h>
+
+// input-space explorer: a breadth-first search over which key is held, a few frames at
+// a time, from a starting machine. each layer goes through three phases:
+//   expand  (parallel) every frontier state tries every choice; only the child's
+//                      position hash and what happened are kept, not the child
+//   select  (serial)   children are deduplicated in slot order and the first `beam`
+//                      new ones are kept, so the result doesn't depend on threading
+//   rebuild (parallel) the kept children are simulated again and packed as the next
+//                      frontier
+// re-simulating the few kept children is cheaper than storing all of them.
+
+// a chip_8 without the byte-per-pixel display and host-only fields, about 4.4 KB
+typedef struct {
+    uint8_t memory[MEMORY_SIZE];
+    uint8_t display[SCREEN_WIDTH * SCREEN_HEIGHT / 8];
+    uint64_t memory_hash;
+    uint64_t display_hash;
+    uint64_t cycles;
+    uint32_t rng;
+    uint16_t pc;
+    uint16_t I;
+    uint16_t stack[STACK_SIZE];
+    uint16_t keyold;
+    uint16_t keycur;
+    uint16_t trap_pc;
+    uint16_t trap_op;
+    uint8_t sp;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t V[16];
+    uint8_t running;
+    uint8_t trap;
+    uint8_t profile;
+} snapshot;
+
+enum {
+    CHILD_TRAP = 1,
+    CHILD_GOAL = 2,
+    CHILD_SAME = 4, // nothing but the key latches changed
+};
+
+typedef struct {
+    uint64_t hash;
+    uint8_t flags;
+    uint8_t trap;
+    uint16_t trap_pc;
+    uint16_t trap_op;
+} child_info;
+
+typedef struct {
+    uint32_t parent;
+    uint8_t action;
+} link;
+
+typedef struct {
+    const explore_params *p;
+    uint8_t actions[EXPLORE_ACTIONS];
+    int action_count;
+    const snapshot *frontier;
+    uint32_t count;
+    child_info *children;
+    const uint32_t *kept;
+    uint32_t kept_count;
+    snapshot *next;
+    atomic_uint cursor;
+    atomic_ullong frames;
+} layer_job;
+
+#define CHUNK 8
+
+static void pack(const chip_8 *c, snapshot *s) {
+    memcpy(s->memory, c->memory, MEMORY_SIZE);
+    memset(s->display, 0, sizeof(s->display));
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            int bit = y * SCREEN_WIDTH + x;
+            s->display[bit / 8] |= c->display[x][y] << (bit % 8);
+        }
+    }
+    s->memory_hash = c->memory_hash;
+    s->display_hash = c->display_hash;
+    s->cycles = c->cycles;
+    s->rng = c->rng;
+    s->pc = c->pc;
+    s->I = c->I;
+    memcpy(s->stack, c->stack, sizeof(s->stack));
+    s->keyold = c->keyold;
+    s->keycur = c->keycur;
+    s->trap_pc = c->trap_pc;
+    s->trap_op = c->trap_op;
+    s->sp = c->sp;
+    s->delay_timer = c->delay_timer;
+    s->sound_timer = c->sound_timer;
+    memcpy(s->V, c->V, sizeof(s->V));
+    s->running = c->running;
+    s->trap = c->trap;
+    s->profile = c->profile;
+}
+
+static void unpack(const snapshot *s, chip_8 *c) {
+    memcpy(c->memory, s->memory, MEMORY_SIZE);
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            int bit = y * SCREEN_WIDTH + x;
+            c->display[x][y] = (s->display[bit / 8] >> (bit % 8)) & 1;
+        }
+    }
+    c->memory_hash = s->memory_hash;
+    c->display_hash = s->display_hash;
+    c->cycles = s->cycles;
+    c->rng = s->rng;
+    c->pc = s->pc;
+    c->I = s->I;
+    memcpy(c->stack, s->stack, sizeof(s->stack));
+    c->keyold = s->keyold;
+    c->keycur = s->keycur;
+    c->trap_pc = s->trap_pc;
+    c->trap_op = s->trap_op;
+    c->sp = s->sp;
+    c->delay_timer = s->delay_timer;
+    c->sound_timer = s->sound_timer;
+    memcpy(c->V, s->V, sizeof(c->V));
+    c->running = s->running;
+    c->trap = s->trap;
+    c->profile = s->profile;
+    c->watchdog = 0;
+}
+
+static uint16_t frontier_op(const snapshot *s) {
+    return s->pc < MEMORY_SIZE - 1 ? s->memory[s->pc] << 8 | s->memory[s->pc + 1] : 0;
+}
+
+static bool goal_met(const chip_8 *c, const explore_goal *g) {
+    switch (g->kind) {
+        case GOAL_TRAP: return c->trap != TRAP_NONE;
+        case GOAL_MEMORY: return c->memory[g->addr] == g->value;
+        case GOAL_PIXEL: return c->display[g->x][g->y];
+        case GOAL_PC: return c->pc == g->addr;
+        default: return false;
+    }
+}
+
+// hold one choice for `hold` frames. a PC goal is checked before every instruction,
+// the others once per frame.
+static bool simulate(chip_8 *c, const explore_params *p, uint8_t action, uint64_t *frames) {
+    uint16_t keys = action ? 1 << (action - 1) : 0;
+    for (int f = 0; f < p->hold && c->running; f++) {
+        begin_frame(c, keys);
+        (*frames)++;
+        if (p->goal.kind == GOAL_PC) {
+            for (int i = 0; i < p->steps_per_frame && c->running; i++) {
+                if (c->pc == p->goal.addr) return true;
+                step(c);
+            }
+        } else {
+            schedule_steps(c, p->steps_per_frame);
+        }
+        if (goal_met(c, &p->goal)) return true;
+    }
+    return false;
+}
+
+static void *expand_thread(void *arg) {
+    layer_job *job = arg;
+    chip_8 *base = chip_alloc(), *child = chip_alloc();
+    uint64_t frames = 0;
+    uint32_t i;
+    while (base && child && (i = atomic_fetch_add(&job->cursor, CHUNK)) < job->count) {
+        uint32_t end = i + CHUNK < job->count ? i + CHUNK : job->count;
+        for (; i < end; i++) {
+            unpack(&job->frontier[i], base);
+            uint64_t parent = program_hash(base);
+            for (int a = 0; a < job->action_count; a++) {
+                *child = *base;
+                child_info *info = &job->children[(size_t) i * job->action_count + a];
+                bool goal = simulate(child, job->p, job->actions[a], &frames);
+                info->hash = position_hash(child);
+                info->flags = (goal ? CHILD_GOAL : 0) | (child->trap != TRAP_NONE ? CHILD_TRAP : 0) |
+                              (program_hash(child) == parent ? CHILD_SAME : 0);
+                info->trap = child->trap;
+                info->trap_pc = child->trap_pc;
+                info->trap_op = child->trap_op;
+            }
+        }
+    }
+    atomic_fetch_add(&job->frames, frames);
+    free(base);
+    free(child);
+    return NULL;
+}
+
+static void *rebuild_thread(void *arg) {
+    layer_job *job = arg;
+    chip_8 *c = chip_alloc();
+    uint64_t frames = 0;
+    uint32_t k;
+    while (c && (k = atomic_fetch_add(&job->cursor, CHUNK)) < job->kept_count) {
+        uint32_t end = k + CHUNK < job->kept_count ? k + CHUNK : job->kept_count;
+        for (; k < end; k++) {
+            uint32_t slot = job->kept[k];
+            unpack(&job->frontier[slot / job->action_count], c);
+            simulate(c, job->p, job->actions[slot % job->action_count], &frames);
+            pack(c, &job->next[k]);
+        }
+    }
+    atomic_fetch_add(&job->frames, frames);
+    free(c);
+    return NULL;
+}
+
+static void run_phase(layer_job *job, void *(*fn)(void *), int threads) {
+    pthread_t workers[64];
+    int started = 0;
+    atomic_store(&job->cursor, 0);
+    while (started < threads && started < 64 && pthread_create(&workers[started], NULL, fn, job) == 0) {
+        started++;
+    }
+    if (started == 0) fn(job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+// positions seen so far: open addressing on the hash itself, 0 marks a free slot
+typedef struct {
+    uint64_t *slots;
+    uint64_t mask;
+    uint32_t count;
+    uint32_t limit;
+} seen_set;
+
+static bool seen_init(seen_set *s, uint32_t limit) {
+    uint64_t capacity = 1024;
+    while (capacity < (uint64_t) limit * 2) capacity *= 2;
+    s->slots = calloc(capacity, sizeof(uint64_t));
+    s->mask = capacity - 1;
+    s->count = 0;
+    s->limit = limit;
+    return s->slots != NULL;
+}
+
+// true if the hash is new. once the set is full nothing more is remembered and
+// everything counts as new.
+static bool seen_insert(seen_set *s, uint64_t hash) {
+    hash |= 1;
+    uint64_t i = (hash * 0x9e3779b97f4a7c15ull) >> 20 & s->mask;
+    while (s->slots[i]) {
+        if (s->slots[i] == hash) return false;
+        i = (i + 1) & s->mask;
+    }
+    if (s->count >= s->limit) return true;
+    s->slots[i] = hash;
+    s->count++;
+    return true;
+}
+
+static void path_to(link *const *links, int layer, uint32_t index, explore_path *out) {
+    out->length = layer;
+    for (int l = layer; l > 0; l--) {
+        out->path[l - 1] = links[l][index].action;
+        index = links[l][index].parent;
+    }
+}
+
+static void child_path(link *const *links, int layer, uint32_t parent, uint8_t action, explore_path *out) {
+    path_to(links, layer, parent, out);
+    out->path[out->length++] = action;
+}
+
+void explore_defaults(explore_params *p) {
+    p->depth = 32;
+    p->beam = 4096;
+    p->hold = 4;
+    p->steps_per_frame = STEPS_PER_FRAME;
+    p->threads = 4;
+    p->keys = 0xffff;
+    p->max_states = 1u << 22;
+    p->goal.kind = GOAL_NONE;
+}
+
+bool explore(const chip_8 *start, const explore_params *p, explore_result *r) {
+    memset(r, 0, sizeof(*r));
+    int depth = p->depth < EXPLORE_MAX_DEPTH ? p->depth : EXPLORE_MAX_DEPTH;
+    layer_job job = {.p = p};
+    job.actions[job.action_count++] = 0;
+    for (int k = 0; k < 16; k++) {
+        if (p->keys >> k & 1) job.actions[job.action_count++] = k + 1;
+    }
+    seen_set seen;
+    link *links[EXPLORE_MAX_DEPTH + 1] = {0};
+    snapshot *frontier = malloc(sizeof(snapshot) * p->beam);
+    snapshot *next = malloc(sizeof(snapshot) * p->beam);
+    child_info *children = malloc(sizeof(child_info) * p->beam * job.action_count);
+    uint32_t *kept = malloc(sizeof(uint32_t) * p->beam);
+    bool ok = frontier && next && children && kept && seen_init(&seen, p->max_states);
+    if (!ok) fprintf(stderr, "[!] failed to allocate the search\n");
+
+    double begin = perf_now();
+    uint32_t count = 1;
+    if (ok) {
+        pack(start, &frontier[0]);
+        seen_insert(&seen, position_hash(start));
+        r->unique = 1;
+    }
+    for (int layer = 0; ok && layer < depth && count && !r->goal_found; layer++) {
+        job.frontier = frontier;
+        job.count = count;
+        job.children = children;
+        run_phase(&job, expand_thread, p->threads);
+
+        uint32_t kept_count = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            bool stuck = true;
+            for (int a = 0; a < job.action_count; a++) {
+                uint32_t slot = i * job.action_count + a;
+                const child_info *info = &children[slot];
+                r->children++;
+                if ((info->flags & CHILD_GOAL) && !r->goal_found) {
+                    r->goal_found = true;
+                    child_path(links, layer, i, job.actions[a], &r->goal);
+                }
+                if (info->flags & CHILD_TRAP) {
+                    stuck = false;
+                    bool known = false;
+                    for (int t = 0; t < r->trap_count; t++) {
+                        known |= r->traps[t].trap == info->trap && r->traps[t].pc == info->trap_pc;
+                    }
+                    if (!known && r->trap_count < EXPLORE_MAX_TRAPS) {
+                        explore_trap *t = &r->traps[r->trap_count++];
+                        t->trap = info->trap;
+                        t->pc = info->trap_pc;
+                        t->op = info->trap_op;
+                        child_path(links, layer, i, job.actions[a], &t->how);
+                    }
+                    continue;
+                }
+                stuck &= (info->flags & CHILD_SAME) != 0;
+                if (!seen_insert(&seen, info->hash)) continue;
+                r->unique++;
+                if (kept_count < (uint32_t) p->beam) kept[kept_count++] = slot;
+            }
+            // input can't change anything, unless it's FX0A waiting for a key to come up
+            if (stuck && (frontier_op(&frontier[i]) & 0xf0ff) != 0xf00a) {
+                if (!r->dead_ends) path_to(links, layer, i, &r->dead_end);
+                r->dead_ends++;
+            }
+        }
+
+        links[layer + 1] = malloc(sizeof(link) * (kept_count ? kept_count : 1));
+        if (!links[layer + 1]) {
+            ok = false;
+            break;
+        }
+        for (uint32_t k = 0; k < kept_count; k++) {
+            links[layer + 1][k] = (link) {kept[k] / job.action_count, job.actions[kept[k] % job.action_count]};
+        }
+        job.kept = kept;
+        job.kept_count = kept_count;
+        job.next = next;
+        run_phase(&job, rebuild_thread, p->threads);
+        snapshot *swap = frontier;
+        frontier = next;
+        next = swap;
+        count = kept_count;
+        r->layers = layer + 1;
+    }
+    r->frames = atomic_load(&job.frames);
+    r->seconds = perf_now() - begin;
+
+    for (int l = 0; l <= EXPLORE_MAX_DEPTH; l++) {
+        free(links[l]);
+    }
+    free(seen.slots);
+    free(frontier);
+    free(next);
+    free(children);
+    free(kept);
+    return ok;
+}
+
+// trap | mem:ADDR=VALUE | pixel:X,Y | pc:ADDR, numbers in C notation
+bool goal_parse(const char *text, explore_goal *goal) {
+    memset(goal, 0, sizeof(*goal));
+    char *end;
+    if (!strcmp(text, "trap")) {
+        goal->kind = GOAL_TRAP;
+        return true;
+    }
+    if (!strncmp(text, "mem:", 4)) {
+        long addr = strtol(text + 4, &end, 0);
+        if (*end != '=' || addr < 0 || addr >= MEMORY_SIZE) return false;
+        goal->kind = GOAL_MEMORY;
+        goal->addr = addr;
+        goal->value = (uint8_t) strtol(end + 1, NULL, 0);
+        return true;
+    }
+    if (!strncmp(text, "pixel:", 6)) {
+        long x = strtol(text + 6, &end, 0);
+        if (*end != ',') return false;
+        long y = strtol(end + 1, NULL, 0);
+        if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT) return false;
+        goal->kind = GOAL_PIXEL;
+        goal->x = x;
+        goal->y = y;
+        return true;
+    }
+    if (!strncmp(text, "pc:", 3)) {
+        long addr = strtol(text + 3, NULL, 0);
+        if (addr < 0 || addr >= MEMORY_SIZE) return false;
+        goal->kind = GOAL_PC;
+        goal->addr = addr;
+        return true;
+    }
+    return false;
+}
+
+// "- - 5 5 C": the key held for each choice, '-' for none
+void explore_path_format(const explore_path *path, char *out, int size) {
+    int used = snprintf(out, size, "%s", path->length ? "" : "(start)");
+    for (int i = 0; i < path->length && used < size; i++) {
+        used += snprintf(out + used, size - used, i ? " %c" : "%c",
+                         path->path[i] ? "0123456789ABCDEF"[path->path[i] - 1] : '-');
+    }
+}
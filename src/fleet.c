@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fleet.h>
+#include <cpu.h>
+
+#define COLD offsetof(chip_8, memory_hash)
+
+bool fleet_init(fleet *f, const chip_8 *start, int count) {
+    memset(f, 0, sizeof(*f));
+    f->current = -1;
+    f->image = malloc(MEMORY_SIZE);
+    f->machines = calloc(count, sizeof(fleet_machine));
+    f->work = chip_alloc();
+    if (!f->image || !f->machines || !f->work) {
+        fprintf(stderr, "[!] failed to allocate a fleet of %d machines\n", count);
+        fleet_free(f);
+        return false;
+    }
+    f->count = count;
+    memcpy(f->image, start->memory, MEMORY_SIZE);
+    for (int i = 0; i < count; i++) {
+        fleet_machine *m = &f->machines[i];
+        memcpy(m->hot, start, CHIP_8_LINE);
+        memcpy(m->display, start->display, sizeof(m->display));
+        memcpy(m->cold, (const uint8_t *) start + COLD, sizeof(m->cold));
+    }
+    return true;
+}
+
+void fleet_free(fleet *f) {
+    for (int i = 0; i < f->count; i++) {
+        for (int p = 0; p < MEMORY_PAGES; p++) {
+            free(f->machines[i].page[p]);
+        }
+    }
+    free(f->machines);
+    free(f->image);
+    free(f->work);
+    memset(f, 0, sizeof(*f));
+    f->current = -1;
+}
+
+// bytes held by the fleet, shared image and private pages included
+size_t fleet_memory(const fleet *f) {
+    return MEMORY_SIZE + f->count * sizeof(fleet_machine) + f->private_pages * MEMORY_PAGE + CHIP_8_ALLOC_SIZE;
+}
+
+// put machine i in the working machine and return it, to run until fleet_leave()
+chip_8 *fleet_enter(fleet *f, int i) {
+    if (f->current >= 0) fleet_leave(f);
+    const fleet_machine *m = &f->machines[i];
+    chip_8 *w = f->work;
+    memcpy(w, m->hot, CHIP_8_LINE);
+    memcpy(w->display, m->display, sizeof(w->display));
+    memcpy((uint8_t *) w + COLD, m->cold, sizeof(m->cold));
+    for (int p = 0; p < MEMORY_PAGES; p++) {
+        const uint8_t *from = m->page[p] ? m->page[p] : f->image + p * MEMORY_PAGE;
+        if (f->loaded[p] == from) continue;
+        memcpy(w->memory + p * MEMORY_PAGE, from, MEMORY_PAGE);
+        f->loaded[p] = from;
+    }
+    w->written = 0;
+    f->current = i;
+    return w;
+}
+
+// park the working machine again, copying out the pages it wrote
+void fleet_leave(fleet *f) {
+    if (f->current < 0) return;
+    fleet_machine *m = &f->machines[f->current];
+    chip_8 *w = f->work;
+    for (int p = 0; w->written; p++, w->written >>= 1) {
+        if (!(w->written & 1)) continue;
+        if (!m->page[p]) {
+            m->page[p] = malloc(MEMORY_PAGE);
+            if (!m->page[p]) {
+                // stop the machine rather than lose the write silently
+                fprintf(stderr, "[!] out of memory for a private page, machine %d stopped\n", f->current);
+                w->running = false;
+                // the working copy no longer matches the shared image
+                f->loaded[p] = NULL;
+                continue;
+            }
+            f->private_pages++;
+        }
+        memcpy(m->page[p], w->memory + p * MEMORY_PAGE, MEMORY_PAGE);
+        f->loaded[p] = m->page[p];
+    }
+    memcpy(m->hot, w, CHIP_8_LINE);
+    memcpy(m->display, w->display, sizeof(m->display));
+    memcpy(m->cold, (const uint8_t *) w + COLD, sizeof(m->cold));
+    f->current = -1;
+}
+
+static uint8_t parked_byte(const fleet *f, const fleet_machine *m, uint16_t addr) {
+    const uint8_t *page = m->page[addr / MEMORY_PAGE];
+    return page ? page[addr % MEMORY_PAGE] : f->image[addr];
+}
+
+// waiting_for_key() for a parked machine whose hot line is staged in `w`
+static bool parked_waiting(const fleet *f, const fleet_machine *m, const chip_8 *w) {
+    uint64_t watchdog;
+    memcpy(&watchdog, m->cold + offsetof(chip_8, watchdog) - COLD, sizeof(watchdog));
+    if (!w->running || w->pc >= MEMORY_SIZE - 1 || (w->keyold & ~w->keycur)) return false;
+    if (watchdog && w->cycles >= watchdog) return false;
+    return (parked_byte(f, m, w->pc) & 0xf0) == 0xf0 && parked_byte(f, m, w->pc + 1) == 0x0a;
+}
+
+// one frame of machine i, returning the instructions it ran. a machine that is
+// waiting_for_key() once the frame's keys latch only moves its timers, keys and cycle
+// count, all in its hot line, so it is run parked instead of entered.
+int fleet_run_frame(fleet *f, int i, uint16_t keys, int steps) {
+    chip_8 *w = f->work;
+    if (f->current != i) {
+        fleet_machine *m = &f->machines[i];
+        // between machines the working machine's hot line is free to stage this one's
+        fleet_leave(f);
+        memcpy(w, m->hot, CHIP_8_LINE);
+        begin_frame(w, keys);
+        bool waiting = parked_waiting(f, m, w);
+        if (waiting) w->cycles += steps;
+        memcpy(m->hot, w, CHIP_8_LINE);
+        if (waiting) return steps;
+        fleet_enter(f, i);
+    } else {
+        begin_frame(w, keys);
+    }
+    return schedule_steps(w, steps);
+}
+
+bool fleet_running(const fleet *f, int i) {
+    if (f->current == i) return f->work->running;
+    bool running;
+    memcpy(&running, f->machines[i].hot + offsetof(chip_8, running), sizeof(running));
+    return running;
+}
@@ -0,0 +1,87 @@
+#include <string.h>
+#include <fuzz.h>
+#include <cpu.h>
+#include <statehash.h>
+
+// fuzzing a ROM means running millions of short-lived machines. init() clears 6 KB
+// field by field and prints twice, so each input instead starts from a copy of a
+// machine that was initialised once; the ROM goes on top through write_memory(),
+// which keeps the memory hash right without hashing all of memory again.
+
+void fuzz_template(chip_8 *template) {
+    init(template);
+    template->running = true;
+}
+
+uint16_t fuzz_keys(const uint8_t *script, int length, uint32_t frame) {
+    if (!length) return 0;
+    const uint8_t *k = script + (frame % length) * 2;
+    return k[0] | k[1] << 8;
+}
+
+// set `c` up for an input: returns its key script, `*length` frames long
+const uint8_t *fuzz_load(const chip_8 *template, chip_8 *c, const uint8_t *data, size_t size, int *length) {
+    *c = *template;
+    c->profile = size > 0 ? data[0] % PROFILE_COUNT : PROFILE_VIP;
+    *length = size > 1 ? data[1] % FUZZ_MAX_SCRIPT : 0;
+    size_t available = size > FUZZ_HEADER ? size - FUZZ_HEADER : 0;
+    if ((size_t) *length * 2 > available) *length = (int) (available / 2);
+    const uint8_t *script = data + FUZZ_HEADER;
+    const uint8_t *rom = script + *length * 2;
+    size_t rom_size = available - *length * 2;
+    if (rom_size > MEMORY_SIZE - PRG_ADDR) rom_size = MEMORY_SIZE - PRG_ADDR;
+    for (size_t i = 0; i < rom_size; i++) {
+        write_memory(c, PRG_ADDR + i, rom[i]);
+    }
+    return script;
+}
+
+void fuzz_one(const chip_8 *template, chip_8 *c, const uint8_t *data, size_t size, fuzz_outcome *out) {
+    int length;
+    const uint8_t *script = fuzz_load(template, c, data, size, &length);
+    for (uint32_t f = 0; f < FUZZ_FRAMES && c->running; f++) {
+        begin_frame(c, fuzz_keys(script, length, f));
+        run_steps(c, STEPS_PER_FRAME, NULL, NULL);
+    }
+    out->trap = c->trap;
+    out->cycles = c->cycles;
+    out->hash_ok = c->memory_hash == memory_hash_full(c) && c->display_hash == display_hash_full(c);
+}
+
+static uint32_t xorshift(uint32_t *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    return *rng;
+}
+
+// a few byte, bit and instruction-sized changes past the header, and now and then a
+// new profile or script length
+void fuzz_mutate(uint8_t *input, size_t size, uint32_t *rng) {
+    if (size <= FUZZ_HEADER) return;
+    for (int m = 0, count = 1 + (xorshift(rng) >> 8) % 8; m < count; m++) {
+        uint32_t r = xorshift(rng);
+        size_t at = FUZZ_HEADER + (r >> 4) % (size - FUZZ_HEADER);
+        switch (r & 3) {
+            case 0: input[at] ^= 1 << ((r >> 24) & 7); break;
+            case 1: input[at] = r >> 24; break;
+            case 2:
+                if ((at | 1) < size) {
+                    input[at & ~(size_t) 1] = (r >> 16) & 0xff;
+                    input[at | 1] = r >> 24;
+                }
+                break;
+            default: input[(r >> 24) & 1] = r >> 16; break;
+        }
+    }
+}
+
+// wrap a ROM as a fuzz input with no key script, for seeding a corpus. returns the
+// input's size, or 0 if it does not fit.
+size_t fuzz_input(const uint8_t *rom, size_t rom_size, quirk_profile profile, uint8_t *out, size_t capacity) {
+    if (rom_size + FUZZ_HEADER > capacity) return 0;
+    out[0] = profile;
+    out[1] = 0;
+    memcpy(out + FUZZ_HEADER, rom, rom_size);
+    return rom_size + FUZZ_HEADER;
+}
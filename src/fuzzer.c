@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fuzz.h>
+
+// fuzz target. built with -fsanitize=fuzzer (ORCA_LIBFUZZER) libFuzzer drives it;
+// otherwise main() replays the files it is given, or stdin, and under afl-clang-fast
+// runs AFL's persistent loop. a trap is a normal outcome; the sanitizers catch the
+// crashes, and a state hash that went wrong aborts.
+
+static chip_8 template_machine;
+static chip_8 machine;
+static int ready;
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!ready) {
+        fuzz_template(&template_machine);
+        ready = 1;
+    }
+    fuzz_outcome out;
+    fuzz_one(&template_machine, &machine, data, size, &out);
+    if (!out.hash_ok) abort();
+    return 0;
+}
+
+#ifndef ORCA_LIBFUZZER
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+#endif
+
+static uint8_t buffer[FUZZ_HEADER + FUZZ_MAX_SCRIPT * 2 + MEMORY_SIZE];
+
+static void run_file(FILE *fp) {
+    size_t size = fread(buffer, 1, sizeof(buffer), fp);
+    LLVMFuzzerTestOneInput(buffer, size);
+}
+
+int main(int argc, char **argv) {
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+    LLVMFuzzerTestOneInput(NULL, 0);
+    __AFL_INIT();
+    const uint8_t *data = __AFL_FUZZ_TESTCASE_BUF;
+    while (__AFL_LOOP(100000)) {
+        LLVMFuzzerTestOneInput(data, __AFL_FUZZ_TESTCASE_LEN);
+    }
+#else
+    if (argc < 2) {
+        run_file(stdin);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp) {
+            fprintf(stderr, "[!] failed to open %s\n", argv[i]);
+            return 1;
+        }
+        run_file(fp);
+        fclose(fp);
+    }
+#endif
+    return 0;
+}
+#endif
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <gen.h>
+
+static const char *gen_names[GEN_COUNT] = {"alu", "draw", "calls", "bulk", "selfmod"};
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} gen_out;
+
+static void put(gen_out *o, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(o->buf + o->len, o->size - o->len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t) n >= o->size - o->len) {
+        o->overflow = true;
+        return;
+    }
+    o->len += n;
+}
+
+// xorshift, so a seed always produces the same ROM
+static unsigned next_rand(unsigned *state) {
+    unsigned x = *state ? *state : 0x9e3779b9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+const char *gen_kind_name(gen_kind kind) {
+    return gen_names[kind];
+}
+
+bool gen_kind_parse(const char *name, gen_kind *kind) {
+    for (int i = 0; i < GEN_COUNT; i++) {
+        if (!strcmp(name, gen_names[i])) {
+            *kind = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void gen_defaults(gen_kind kind, gen_params *p) {
+    memset(p, 0, sizeof(*p));
+    p->kind = kind;
+    p->unroll = 16;
+    p->height = 15;
+    p->depth = STACK_SIZE;
+    p->regs = 15;
+    p->seed = 1;
+}
+
+static void gen_alu(const gen_params *p, gen_out *o) {
+    static const char *ops[] = {"+=", "-=", "|=", "&=", "^=", ">>=", "<<=", "=-"};
+    unsigned rng = p->seed;
+    put(o, "v0 := 1\nv1 := 3\nv2 := 7\nv3 := 15\n");
+    put(o, "loop\n");
+    for (int i = 0; i < p->unroll; i++) {
+        int x = next_rand(&rng) % 14;
+        int y = next_rand(&rng) % 14;
+        if (i % 3 == 0) {
+            put(o, "  v%x += %u\n", x, next_rand(&rng) & 0xff);
+        } else {
+            put(o, "  v%x %s v%x\n", x, ops[next_rand(&rng) % 8], y);
+        }
+    }
+    put(o, "again\n");
+}
+
+// sprites start near the right/bottom edges so most draws get clipped
+static void gen_draw(const gen_params *p, gen_out *o) {
+    int h = p->height < 1 ? 1 : p->height > 15 ? 15 : p->height;
+    put(o, "v0 := 56\nv1 := 24\nv2 := 0\n");
+    put(o, "loop\n");
+    for (int i = 0; i < p->unroll; i++) {
+        put(o, "  i := tile\n  sprite v0 v1 %d\n  v0 += %d\n  v1 += %d\n", h, 3 + (i & 3), 1 + (i & 1));
+    }
+    put(o, "  v2 += 1\n  if v2 == 64 then clear\nagain\n");
+    put(o, ": tile\n");
+    unsigned rng = p->seed;
+    for (int i = 0; i < 15; i++) {
+        put(o, "0x%02x ", (next_rand(&rng) & 0xff) | 0x81);
+    }
+    put(o, "\n");
+}
+
+// fN calls fN+1 down to the deepest level, which returns straight away
+static void gen_calls(const gen_params *p, gen_out *o) {
+    int depth = p->depth < 1 ? 1 : p->depth > STACK_SIZE ? STACK_SIZE : p->depth;
+    put(o, "loop\n");
+    for (int i = 0; i < p->unroll; i++) {
+        put(o, "  f0\n");
+    }
+    put(o, "again\n");
+    for (int d = 0; d < depth; d++) {
+        put(o, ": f%d\n  v%x += 1\n", d, d & 0xe);
+        if (d + 1 < depth) put(o, "  f%d\n", d + 1);
+        put(o, "  return\n");
+    }
+}
+
+static void gen_bulk(const gen_params *p, gen_out *o) {
+    int r = p->regs < 0 ? 0 : p->regs > 15 ? 15 : p->regs;
+    put(o, "loop\n");
+    for (int i = 0; i < p->unroll; i++) {
+        put(o, "  i := buffer\n  save v%x\n  v0 += 1\n  i := buffer\n  load v%x\n", r, r);
+    }
+    put(o, "again\n: buffer\n");
+    for (int i = 0; i <= r; i++) {
+        put(o, "0 ");
+    }
+    put(o, "\n");
+}
+
+// patches the immediate of a 6XNN right before executing it
+static void gen_selfmod(const gen_params *p, gen_out *o) {
+    put(o, "v0 := 0x65\nv1 := 0\n");
+    put(o, "loop\n");
+    for (int i = 0; i < p->unroll; i++) {
+        put(o, "  v1 += 1\n  i := patched%d\n  save v1\n  : patched%d\n  v5 := 0\n", i, i);
+    }
+    put(o, "again\n");
+}
+
+bool gen_source(const gen_params *p, char *buf, size_t size) {
+    gen_out o = {buf, size, 0, false};
+    buf[0] = 0;
+    put(&o, "# generated %s workload, seed %u\n", gen_names[p->kind], p->seed);
+    switch (p->kind) {
+        case GEN_ALU:
+            gen_alu(p, &o);
+            break;
+        case GEN_DRAW:
+            gen_draw(p, &o);
+            break;
+        case GEN_CALLS:
+            gen_calls(p, &o);
+            break;
+        case GEN_BULK:
+            gen_bulk(p, &o);
+            break;
+        case GEN_SELFMOD:
+            gen_selfmod(p, &o);
+            break;
+        default:
+            return false;
+    }
+    return !o.overflow;
+}
+
+bool gen_rom(const gen_params *p, asm_result *out) {
+    static char source[1 << 16];
+    if (!gen_source(p, source, sizeof(source))) {
+        memset(out, 0, sizeof(*out));
+        snprintf(out->error, sizeof(out->error), "generated source too large");
+        return false;
+    }
+    return assemble(source, out);
+}
@@ -1,6 +1,7 @@
 #include <graphics.h>
 #include <raylib.h>
-void draw_sprite_ray(chip_8 *c) {
+#include <raygui.h>
+void draw_sprite_ray(const chip_8 *c) {
     BeginDrawing();
     for (int x = 0; x < 64; x++) {
         for (int y = 0; y < 32; y++) {
@@ -10,4 +11,35 @@ void draw_sprite_ray(chip_8 *c) {
         }
     }
     EndDrawing();
-}
\ No newline at end of file
+}
+
+static void draw_histogram(const uint32_t hist[PERF_HIST_BUCKETS], Rectangle bounds, const char *title, Color color) {
+    uint32_t max = 1;
+    for (int i = 0; i < PERF_HIST_BUCKETS; i++) {
+        if (hist[i] > max) max = hist[i];
+    }
+    GuiGroupBox(bounds, title);
+    float bar_w = (bounds.width - 8) / PERF_HIST_BUCKETS;
+    float inner_h = bounds.height - 16;
+    for (int i = 0; i < PERF_HIST_BUCKETS; i++) {
+        float h = inner_h * hist[i] / max;
+        DrawRectangle(bounds.x + 4 + i * bar_w, bounds.y + bounds.height - 4 - h, bar_w - 1, h, color);
+    }
+    DrawText(TextFormat("0..%.0fms", PERF_HIST_MS), bounds.x + bounds.width - 60, bounds.y + 8, 10, GRAY);
+}
+
+// live performance HUD shown inside the tweak window
+void draw_perf_hud(const perf_stats *s, Rectangle bounds, size_t footprint) {
+    float x = bounds.x + 8;
+    float y = bounds.y + 8;
+    float w = bounds.width - 16;
+    GuiLabel((Rectangle) {x, y, w, 16}, TextFormat("IPS: %.0f", s->ips));
+    GuiLabel((Rectangle) {x, y + 16, w, 16}, TextFormat("speed: %.2fx realtime", s->speed));
+    GuiLabel((Rectangle) {x, y + 32, w, 16}, TextFormat("frame: %.2fms", s->frame_ms));
+    GuiLabel((Rectangle) {x, y + 48, w, 16}, TextFormat("step(): %.3fms  draw: %.3fms", s->step_ms, s->render_ms));
+    GuiLabel((Rectangle) {x, y + 64, w, 16}, TextFormat("idle spins: %.1f%%", s->idle_pct));
+    GuiLabel((Rectangle) {x, y + 80, w, 16}, TextFormat("memory: %.1f KiB", footprint / 1024.0));
+
+    draw_histogram(s->frame_hist, (Rectangle) {x, y + 108, w, 72}, "frame time", DARKGRAY);
+    draw_histogram(s->render_hist, (Rectangle) {x, y + 192, w, 72}, "render time", MAROON);
+}
@@ -0,0 +1,1273 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <main.h>
+#include <cpu.h>
+#include <perf.h>
+#include <perfcount.h>
+#include <asm.h>
+#include <gen.h>
+#include <debug.h>
+#include <disasm.h>
+#include <rewind.h>
+#include <detect.h>
+#include <library.h>
+#include <bootcache.h>
+#include <runahead.h>
+#include <netplay.h>
+#include <statehash.h>
+#include <explore.h>
+#include <tas.h>
+#include <fuzz.h>
+#include <diffcheck.h>
+#include <cfg.h>
+#include <fleet.h>
+#include <input.h>
+#include <unistd.h>
+#include <time.h>
+
+// headless runner: the core without raylib, for benchmarks and batch jobs
+
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *usage;
+} command;
+
+static void print_display(const chip_8 *c) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            putchar(c->display[x][y] ? '#' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+// parse generator options (--source, --unroll, --height, --depth, --regs, --seed) from argv[start..]
+static bool parse_gen_args(int argc, char **argv, int start, gen_params *p, bool *show_source) {
+    for (int i = start; i < argc; i++) {
+        if (!strcmp(argv[i], "--source")) {
+            *show_source = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        int value = (int) strtol(argv[i + 1], NULL, 0);
+        if (!strcmp(argv[i], "--unroll")) {
+            p->unroll = value;
+        } else if (!strcmp(argv[i], "--height")) {
+            p->height = value;
+        } else if (!strcmp(argv[i], "--depth")) {
+            p->depth = value;
+        } else if (!strcmp(argv[i], "--regs")) {
+            p->regs = value;
+        } else if (!strcmp(argv[i], "--seed")) {
+            p->seed = (unsigned) value;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+// a ROM argument is either a file or "gen:<kind>" for a generated workload with default parameters
+static bool load_rom_arg(chip_8 *c, const char *arg) {
+    if (!strncmp(arg, "gen:", 4)) {
+        gen_params p;
+        static asm_result rom;
+        gen_kind kind;
+        if (!gen_kind_parse(arg + 4, &kind)) {
+            fprintf(stderr, "[!] unknown workload %s\n", arg + 4);
+            return false;
+        }
+        gen_defaults(kind, &p);
+        if (!gen_rom(&p, &rom)) {
+            fprintf(stderr, "[!] failed to generate %s: %s\n", arg + 4, rom.error);
+            return false;
+        }
+        return load_buffer(c, rom.code, rom.size);
+    }
+    return load(c, arg);
+}
+
+// print why the machine stopped by itself, if it did. returns true if it trapped.
+static bool report_trap(const chip_8 *c) {
+    if (c->trap == TRAP_NONE) return false;
+    char text[24];
+    disasm(c->trap_op, profile_quirks(c->profile), text, sizeof(text));
+    fprintf(stderr, "[!] %s at %03X (%s) after %llu instructions\n", trap_name(c->trap), c->trap_pc, text,
+            (unsigned long long) c->cycles);
+    return true;
+}
+
+static bool write_file(const char *filename, const uint8_t *data, int size) {
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "[!] failed to open %s for writing\n", filename);
+        return false;
+    }
+    fwrite(data, 1, size, fp);
+    fclose(fp);
+    return true;
+}
+
+// asm: assemble an Octo-subset source file into a ROM
+static int cmd_asm(int argc, char **argv) {
+    if (argc != 2) return -1;
+    FILE *fp = fopen(argv[0], "rb");
+    if (!fp) {
+        fprintf(stderr, "[!] failed to open %s\n", argv[0]);
+        return 1;
+    }
+    static char source[1 << 20];
+    size_t n = fread(source, 1, sizeof(source) - 1, fp);
+    source[n] = 0;
+    fclose(fp);
+
+    static asm_result rom;
+    if (!assemble(source, &rom)) {
+        fprintf(stderr, "%s:%d: %s\n", argv[0], rom.error_line, rom.error);
+        return 1;
+    }
+    if (!write_file(argv[1], rom.code, rom.size)) return 1;
+    printf("[*] assembled %d bytes\n", rom.size);
+    return 0;
+}
+
+// gen: write a synthetic workload ROM (and its source with --source)
+static int cmd_gen(int argc, char **argv) {
+    if (argc < 2) return -1;
+    gen_kind kind;
+    if (!gen_kind_parse(argv[0], &kind)) {
+        fprintf(stderr, "[!] unknown workload %s, expected one of:", argv[0]);
+        for (int i = 0; i < GEN_COUNT; i++) {
+            fprintf(stderr, " %s", gen_kind_name(i));
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    gen_params p;
+    gen_defaults(kind, &p);
+    bool show_source = false;
+    if (!parse_gen_args(argc, argv, 2, &p, &show_source)) return -1;
+
+    static char source[1 << 16];
+    static asm_result rom;
+    if (!gen_source(&p, source, sizeof(source)) || !assemble(source, &rom)) {
+        fprintf(stderr, "[!] failed to generate %s: %s\n", argv[0], rom.error);
+        return 1;
+    }
+    if (show_source) fputs(source, stdout);
+    if (!write_file(argv[1], rom.code, rom.size)) return 1;
+    printf("[*] generated %s workload, %d bytes\n", argv[0], rom.size);
+    return 0;
+}
+
+// run: execute a ROM for a number of frames and dump the display
+// "--profile <name>" at argv[i]: sets *profile and advances i past the value.
+// returns false if argv[i] isn't that option; exits the command with a usage error on a bad name.
+static bool parse_profile_arg(int argc, char **argv, int *i, quirk_profile *profile, bool *ok) {
+    if (strcmp(argv[*i], "--profile") || *i + 1 >= argc) return false;
+    *ok = profile_parse(argv[++*i], profile);
+    if (!*ok) fprintf(stderr, "[!] unknown profile %s, expected vip, schip or xochip\n", argv[*i]);
+    return true;
+}
+
+// with --watchdog, a ROM that runs more than N instructions is stopped with a trap.
+// --input replays key events recorded by the GUI (F6), each at its instruction, with
+// the profile and steps per frame they were recorded with.
+static int cmd_run(int argc, char **argv) {
+    if (argc < 1) return -1;
+    long frames = 600;
+    uint64_t watchdog = 0;
+    quirk_profile profile = PROFILE_VIP;
+    int steps_per_frame = STEPS_PER_FRAME;
+    bool profile_set = false, spf_set = false;
+    const char *input_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+            profile_set = true;
+        } else if (!strcmp(argv[i], "--watchdog") && i + 1 < argc) {
+            watchdog = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--spf") && i + 1 < argc) {
+            steps_per_frame = (int) strtol(argv[++i], NULL, 10);
+            spf_set = true;
+            if (steps_per_frame < 1) return -1;
+        } else if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+            input_path = argv[++i];
+        } else if (argv[i][0] != '-') {
+            frames = strtol(argv[i], NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+    key_event *events = NULL;
+    uint32_t event_count = 0, next = 0;
+    if (input_path) {
+        FILE *fp = fopen(input_path, "r");
+        if (!fp) {
+            fprintf(stderr, "[!] failed to open %s\n", input_path);
+            return 1;
+        }
+        input_header header;
+        events = input_read(fp, &header, &event_count);
+        fclose(fp);
+        if (!events) return 1;
+        // a replay under other settings would be a different run
+        if ((profile_set && profile != header.profile) || (spf_set && steps_per_frame != header.steps_per_frame)) {
+            fprintf(stderr, "[!] %s was recorded with the %s profile at %d steps per frame\n", input_path,
+                    profile_name(header.profile), header.steps_per_frame);
+            free(events);
+            return 1;
+        }
+        profile = header.profile;
+        steps_per_frame = header.steps_per_frame;
+        printf("[*] replaying %u key events\n", event_count);
+    }
+    static chip_8 c8;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) {
+        free(events);
+        return 1;
+    }
+    set_watchdog(&c8, watchdog);
+    c8.profile = profile;
+    c8.running = true;
+    static input_queue queue;
+    for (long f = 0; f < frames && c8.running; f++) {
+        // the queue only has to hold what one frame needs
+        while (next < event_count && events[next].frame <= f && input_push(&queue, events[next])) next++;
+        input_run_frame(&c8, &queue, (uint32_t) f, steps_per_frame, NULL, NULL, NULL);
+    }
+    free(events);
+    print_display(&c8);
+    return report_trap(&c8) ? 2 : 0;
+}
+
+// time `frames` frames shared out over the machines, `slice` frames each in turn.
+// the machines are either m[] or, with `shared`, a fleet's
+static void bench_machines(chip_8 **m, fleet *shared, int instances, int slice, long frames, run_ahead *ahead,
+                           bool use_counters) {
+    perf_counters pc;
+    if (use_counters) use_counters = counters_open(&pc);
+
+    long each = frames / instances / slice > 0 ? frames / instances / slice : 1;
+    int live = instances;
+    uint64_t steps = 0;
+    long f = 0;
+    if (use_counters) counters_start(&pc);
+    double start = perf_now();
+    for (; f < each && live; f++) {
+        for (int i = 0; i < instances; i++) {
+            // machines blocked in FX0A are skipped until their next frame, see schedule_steps()
+            for (int s = 0; s < slice && (shared ? fleet_running(shared, i) : m[i]->running); s++) {
+                steps += shared ? fleet_run_frame(shared, i, 0, STEPS_PER_FRAME) : run_frame(m[i], 0);
+                if (!(shared ? fleet_running(shared, i) : m[i]->running)) live--;
+            }
+        }
+        if (!shared) run_ahead_frame(ahead, m[0], 0, STEPS_PER_FRAME);
+    }
+    double elapsed = perf_now() - start;
+    if (use_counters) counters_stop(&pc);
+    f *= (long) instances * slice;
+
+    report_trap(shared ? fleet_enter(shared, 0) : m[0]);
+    printf("[*] %ld frames, %llu instructions in %.3fs\n", f, (unsigned long long) steps, elapsed);
+    printf("    %.0f instructions/s, %.0f frames/s (%.1fx realtime)\n",
+           steps / elapsed, f / elapsed, f / elapsed / 60.0);
+    if (shared) {
+        printf("    %d machines sharing one image, %zu private pages, %.1f MiB in all\n", instances,
+               shared->private_pages, fleet_memory(shared) / (double) (1 << 20));
+    } else if (instances > 1) {
+        printf("    %d machines of %zu bytes, %.1f MiB in all\n", instances, CHIP_8_ALLOC_SIZE,
+               instances * (double) CHIP_8_ALLOC_SIZE / (1 << 20));
+    }
+    if (ahead->frames) printf("    running %d frames ahead, %.1fus per frame\n", ahead->frames, elapsed / f * 1e6);
+    if (use_counters) {
+        printf("    %-14s %16s %12s %12s\n", "counter", "total", "per instr", "per frame");
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            if (!counter_available(&pc, i)) continue;
+            printf("    %-14s %16llu %12.2f %12.1f\n", counter_name(i), (unsigned long long) pc.value[i],
+                   steps ? (double) pc.value[i] / steps : 0.0, f ? (double) pc.value[i] / f : 0.0);
+        }
+        if (counter_available(&pc, COUNTER_CYCLES) && counter_available(&pc, COUNTER_INSTRUCTIONS) &&
+            pc.value[COUNTER_CYCLES]) {
+            printf("    IPC %.2f\n", (double) pc.value[COUNTER_INSTRUCTIONS] / pc.value[COUNTER_CYCLES]);
+        }
+        counters_close(&pc);
+    }
+}
+
+// bench: time a ROM over many frames, optionally with hardware counters. with
+// --run-ahead N every frame also speculates N frames ahead, as the GUI does. with
+// --instances N the frames are shared out over N copies of the machine, run a frame
+// each in turn the way a batch host would, so the counters show what the working
+// set of many machines costs in cache misses. --slice N runs each for N frames per
+// turn. --shared runs them as a fleet instead, sharing the memory they have not written.
+static int cmd_bench(int argc, char **argv) {
+    if (argc < 1) return -1;
+    long frames = 100000;
+    int instances = 1, slice = 1;
+    bool use_counters = false, use_fleet = false;
+    quirk_profile profile = PROFILE_VIP;
+    static run_ahead ahead;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--run-ahead") && i + 1 < argc) {
+            ahead.frames = (int) strtol(argv[++i], NULL, 10);
+            if (ahead.frames < 0 || ahead.frames > RUN_AHEAD_MAX) return -1;
+        } else if (!strcmp(argv[i], "--instances") && i + 1 < argc) {
+            instances = (int) strtol(argv[++i], NULL, 10);
+            if (instances < 1) return -1;
+        } else if (!strcmp(argv[i], "--slice") && i + 1 < argc) {
+            slice = (int) strtol(argv[++i], NULL, 10);
+            if (slice < 1) return -1;
+        } else if (!strcmp(argv[i], "--shared")) {
+            use_fleet = true;
+        } else if (!strcmp(argv[i], "--counters")) {
+            use_counters = true;
+        } else {
+            return -1;
+        }
+    }
+    if (ahead.frames && (instances > 1 || slice > 1 || use_fleet)) {
+        fprintf(stderr, "[!] --run-ahead needs a single instance\n");
+        return 1;
+    }
+
+    chip_8 **m = calloc(instances, sizeof(chip_8 *));
+    int allocated = 0;
+    if (m && (m[0] = chip_alloc())) allocated = 1;
+    bool ok = allocated == 1;
+    if (!ok) fprintf(stderr, "[!] failed to allocate %d machines\n", instances);
+    if (ok) {
+        init(m[0]);
+        ok = load_rom_arg(m[0], argv[0]);
+        m[0]->profile = profile;
+        m[0]->running = true;
+    }
+    if (ok && use_fleet) {
+        static fleet shared;
+        ok = fleet_init(&shared, m[0], instances);
+        if (ok) bench_machines(NULL, &shared, instances, slice, frames, &ahead, use_counters);
+        fleet_free(&shared);
+    } else {
+        // every copy starts from the same loaded machine
+        for (; ok && allocated < instances; allocated++) {
+            if (!(m[allocated] = chip_alloc())) break;
+            *m[allocated] = *m[0];
+        }
+        if (ok && allocated < instances) {
+            fprintf(stderr, "[!] failed to allocate %d machines\n", instances);
+            ok = false;
+        }
+        if (ok) bench_machines(m, NULL, instances, slice, frames, &ahead, use_counters);
+    }
+    for (int i = 0; i < allocated; i++) {
+        free(m[i]);
+    }
+    free(m);
+    return ok ? 0 : 1;
+}
+
+static void print_state(const chip_8 *c) {
+    printf("    PC %03X  I %03X  SP %X  DT %02X  ST %02X\n    V ", c->pc, c->I, c->sp, c->delay_timer,
+           c->sound_timer);
+    for (int i = 0; i < 16; i++) {
+        printf("%02X ", c->V[i]);
+    }
+    printf("\n");
+}
+
+// parse "vX==N", "vX!=N", "vX<N" or "vX>N", optionally followed by "@addr"
+static bool parse_condition_arg(const char *arg, debugger *d) {
+    unsigned reg, value, pc = ANY_PC;
+    char op[3] = {0};
+    if (sscanf(arg, "v%x%2[=!<>]%i", &reg, op, &value) != 3 && sscanf(arg, "V%x%2[=!<>]%i", &reg, op, &value) != 3) {
+        return false;
+    }
+    const char *at = strchr(arg, '@');
+    if (at) pc = (unsigned) strtol(at + 1, NULL, 0);
+    cond_op cop;
+    if (!strcmp(op, "==")) {
+        cop = COND_EQ;
+    } else if (!strcmp(op, "!=")) {
+        cop = COND_NE;
+    } else if (!strcmp(op, "<")) {
+        cop = COND_LT;
+    } else if (!strcmp(op, ">")) {
+        cop = COND_GT;
+    } else {
+        return false;
+    }
+    return debug_add_condition(d, pc, reg, cop, value);
+}
+
+// debug: run with breakpoints/watchpoints armed, reporting every stop and resuming
+static int cmd_debug(int argc, char **argv) {
+    if (argc < 1) return -1;
+    static debugger dbg;
+    debug_reset(&dbg);
+    long frames = 600;
+    int max_hits = 10;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return -1;
+        const char *value = argv[++i];
+        if (!strcmp(argv[i - 1], "--frames")) {
+            frames = strtol(value, NULL, 10);
+        } else if (!strcmp(argv[i - 1], "--max-hits")) {
+            max_hits = (int) strtol(value, NULL, 10);
+        } else if (!strcmp(argv[i - 1], "--break")) {
+            debug_toggle_breakpoint(&dbg, (uint16_t) strtol(value, NULL, 0));
+        } else if (!strcmp(argv[i - 1], "--break-if")) {
+            if (!parse_condition_arg(value, &dbg)) return -1;
+        } else if (!strcmp(argv[i - 1], "--watch")) {
+            char *end;
+            long start = strtol(value, &end, 0);
+            long stop = *end == '-' ? strtol(end + 1, NULL, 0) + 1 : start + 1;
+            if (!debug_add_watch(&dbg, start, stop)) return -1;
+        } else {
+            return -1;
+        }
+    }
+
+    static chip_8 c8;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    c8.running = true;
+
+    int hits = 0;
+    for (long f = 0; f < frames && hits < max_hits; f++) {
+        begin_frame(&c8, 0);
+        int left = STEPS_PER_FRAME;
+        while (left > 0 && hits < max_hits) {
+            left -= run_steps(&c8, left, &dbg, NULL);
+            if (c8.running) continue;
+            if (dbg.hit == HIT_NONE) {
+                report_trap(&c8);
+                break;
+            }
+            char text[24];
+            disasm(opcode_at(&c8, dbg.hit_pc), profile_quirks(c8.profile), text, sizeof(text));
+            printf("[*] frame %ld: %s at %03X (%s)", f, debug_hit_name(dbg.hit), dbg.hit_pc, text);
+            if (dbg.hit == HIT_WATCHPOINT) printf(", wrote %03X", dbg.hit_addr);
+            printf("\n");
+            print_state(&c8);
+            hits++;
+            c8.running = true;
+        }
+        if (!c8.running) break;
+    }
+    return 0;
+}
+
+// rewind: record a long run, then time the reverse-debugging queries against it
+static int cmd_rewind(int argc, char **argv) {
+    if (argc < 1) return -1;
+    long frames = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    static chip_8 c8;
+    static rewind_log history;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    if (!rewind_init(&history, REWIND_BUDGET)) return 1;
+    c8.running = true;
+    rewind_reset(&history, &c8);
+
+    // pseudo-random key presses, each held for a while, so the log has something to replay
+    uint32_t keys_rng = 1;
+    uint16_t keys = 0;
+    long held = 0;
+    double start = perf_now();
+    for (long f = 0; f < frames && c8.running; f++) {
+        if (held-- <= 0) {
+            keys_rng = keys_rng * 1103515245 + 12345;
+            keys = (keys_rng >> 12) & 1 ? 1 << ((keys_rng >> 16) & 0xf) : 0;
+            held = (keys_rng >> 20) & 0x3f;
+        }
+        rewind_begin_frame(&history, &c8, keys);
+        rewind_add_steps(&history, &c8, run_steps(&c8, STEPS_PER_FRAME, NULL, NULL));
+    }
+    report_trap(&c8);
+    printf("[*] recorded %llu instructions in %.3fs, %d checkpoints every %llu, %.1f MiB\n",
+           (unsigned long long) c8.cycles, perf_now() - start, history.checkpoint_count,
+           (unsigned long long) history.interval, rewind_memory(&history) / 1048576.0);
+
+    uint64_t cycle;
+    uint16_t pc;
+    start = perf_now();
+    bool found = rewind_last_write(&history, &c8, 0, MEMORY_SIZE, &cycle, &pc);
+    printf("[*] last write: %s", found ? "" : "none");
+    if (found) printf("%03X at cycle %llu", pc, (unsigned long long) cycle);
+    printf(" (%.3fms)\n", (perf_now() - start) * 1000.0);
+
+    // from the end of the recording, before reverse-continue takes the machine back
+    start = perf_now();
+    for (int i = 0; i < 100; i++) {
+        rewind_step_back(&history, &c8);
+    }
+    printf("[*] 100 reverse steps to cycle %llu (%.3fms)\n", (unsigned long long) c8.cycles,
+           (perf_now() - start) * 1000.0);
+
+    static debugger dbg;
+    debug_reset(&dbg);
+    debug_toggle_breakpoint(&dbg, PRG_ADDR);
+    start = perf_now();
+    found = rewind_continue_back(&history, &c8, &dbg);
+    printf("[*] reverse-continue to %03X: %s at cycle %llu (%.3fms)\n", PRG_ADDR, found ? "hit" : "no hit",
+           (unsigned long long) c8.cycles, (perf_now() - start) * 1000.0);
+
+    rewind_free(&history);
+    return 0;
+}
+
+// boot: skip a ROM's input-free boot prefix, cold and then from the cache, and check
+// that the skipped machine ends up where one that ran every frame does
+static int cmd_boot(int argc, char **argv) {
+    if (argc < 1) return -1;
+    const char *dir = BOOT_CACHE_DIR;
+    quirk_profile profile = PROFILE_VIP;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+        } else if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            return -1;
+        }
+    }
+    static chip_8 fresh, skipped, live;
+    init(&fresh);
+    if (!load_rom_arg(&fresh, argv[0])) return 1;
+    fresh.profile = profile;
+    fresh.running = true;
+    uint8_t digest[SHA1_SIZE];
+    if (strncmp(argv[0], "gen:", 4) != 0) {
+        if (!rom_sha1_file(argv[0], digest)) return 1;
+    } else {
+        sha1(fresh.memory + PRG_ADDR, MEMORY_SIZE - PRG_ADDR, digest);
+    }
+
+    long frames = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        skipped = fresh;
+        bool cached;
+        double start = perf_now();
+        frames = boot_skip(&skipped, digest, STEPS_PER_FRAME, dir, &cached);
+        printf("[*] %s: skipped %ld frames (%llu instructions) in %.3fms\n", cached ? "cached" : "cold", frames,
+               (unsigned long long) skipped.cycles, (perf_now() - start) * 1000.0);
+    }
+
+    live = fresh;
+    for (long f = 0; f < frames; f++) {
+        run_frame(&live, 0);
+    }
+    bool same = !memcmp(&live, &skipped, sizeof(chip_8));
+    printf("[*] next instruction %04X at %03X, %s a live run\n", opcode_at(&skipped, skipped.pc), skipped.pc,
+           same ? "identical to" : "DIFFERENT from");
+    return same ? 0 : 1;
+}
+
+// scripted keys for a netplay player: a key from its half held for a while, or nothing
+static uint16_t netplay_keys(int player, uint32_t frame) {
+    uint32_t x = (frame / 12 + 1) * 2654435761u ^ (player + 1) * 0x9e3779b9u;
+    x ^= x >> 15;
+    return x & 1 ? 1 << ((x >> 4) & 0xf) : 0;
+}
+
+static void sleep_until(double t) {
+    double wait = t - perf_now();
+    if (wait <= 0) return;
+    struct timespec ts = {(time_t) wait, (long) ((wait - (time_t) wait) * 1e9)};
+    nanosleep(&ts, NULL);
+}
+
+// netplay: one side of a two-process session with scripted input, e.g. on one machine
+//   orca-headless netplay pong.ch8 1 7458 127.0.0.1:7459
+//   orca-headless netplay pong.ch8 2 7459 127.0.0.1:7458
+// both print the same final hash unless the session desynced
+static int cmd_netplay(int argc, char **argv) {
+    if (argc < 4) return -1;
+    long frames = 600;
+    int fps = 60;
+    uint32_t loss = 0;
+    quirk_profile profile = PROFILE_VIP;
+    for (int i = 4; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            fps = (int) strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--loss") && i + 1 < argc) {
+            loss = (uint32_t) strtoul(argv[++i], NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+    int player = (int) strtol(argv[1], NULL, 10) - 1;
+    if (player < 0 || player > 1) return -1;
+
+    static chip_8 c8;
+    static netplay net;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    c8.profile = profile;
+    c8.running = true;
+    if (!netplay_open(&net, player, (uint16_t) strtol(argv[2], NULL, 10), argv[3])) return 1;
+    net.loss_percent = loss;
+    netplay_start(&net, &c8, STEPS_PER_FRAME);
+
+    // paced like the GUI; a peer that stays silent for 10s ends the session
+    double period = fps > 0 ? 1.0 / fps : 0, next = perf_now(), heard = perf_now();
+    uint32_t received = 0;
+    while (net.confirmed < frames || (net.peer_ack < frames && perf_now() - heard < 1.0)) {
+        if (net.frame < frames) {
+            netplay_frame(&net, netplay_keys(player, net.frame));
+        } else {
+            netplay_poll(&net);
+        }
+        if (net.bad_peer) break;
+        if (net.received != received) {
+            received = net.received;
+            heard = perf_now();
+        } else if (perf_now() - heard > 10.0) {
+            fprintf(stderr, "[!] no packets from the peer for 10s\n");
+            break;
+        }
+        next += period;
+        sleep_until(next);
+    }
+    netplay_close(&net);
+
+    printf("[*] player %d: %u frames confirmed, state %016llx\n", player + 1, net.confirmed,
+           (unsigned long long) machine_hash(&net.sync));
+    printf("    %u rollbacks, %u frames re-simulated, deepest %u, slowest %.3fms\n", net.rollbacks,
+           net.rollback_frames, net.max_rollback, net.max_resim_ms);
+    printf("    %u stalls, %u packets sent, %u received\n", net.stalls, net.sent, net.received);
+    if (net.bad_peer || net.confirmed < frames) return 1;
+    return net.desync_frame >= 0 ? 2 : 0;
+}
+
+// explore: search the key inputs from the end of the boot prefix for traps, dead ends
+// or a goal, and print how to get there
+static int cmd_explore(int argc, char **argv) {
+    if (argc < 1) return -1;
+    explore_params p;
+    explore_defaults(&p);
+    p.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    quirk_profile profile = PROFILE_VIP;
+    bool from_boot = true;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+        } else if (!strcmp(argv[i], "--no-boot")) {
+            from_boot = false;
+        } else if (i + 1 >= argc) {
+            return -1;
+        } else if (!strcmp(argv[i], "--goal")) {
+            if (!goal_parse(argv[++i], &p.goal)) return -1;
+        } else if (!strcmp(argv[i], "--keys")) {
+            p.keys = (uint16_t) strtol(argv[++i], NULL, 0);
+        } else {
+            long value = strtol(argv[i + 1], NULL, 10);
+            if (!strcmp(argv[i], "--depth")) {
+                p.depth = (int) value;
+            } else if (!strcmp(argv[i], "--beam")) {
+                p.beam = (int) value;
+            } else if (!strcmp(argv[i], "--hold")) {
+                p.hold = (int) value;
+            } else if (!strcmp(argv[i], "--threads")) {
+                p.threads = (int) value;
+            } else {
+                return -1;
+            }
+            i++;
+        }
+    }
+    if (p.depth < 1 || p.beam < 1 || p.hold < 1) return -1;
+
+    static chip_8 c8;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    c8.profile = profile;
+    c8.running = true;
+    // no input can matter before the first keypad read, so the search starts there
+    if (from_boot) printf("[*] skipped %ld boot frames\n", boot_prefix(&c8, STEPS_PER_FRAME, BOOT_MAX_FRAMES));
+
+    static explore_result r;
+    if (!explore(&c8, &p, &r)) return 1;
+    printf("[*] %d layers, %llu states (%llu distinct), %llu frames in %.3fs, %.2fM frames/s on %d threads\n",
+           r.layers, (unsigned long long) r.children, (unsigned long long) r.unique, (unsigned long long) r.frames,
+           r.seconds, r.frames / r.seconds / 1e6, p.threads);
+
+    char path[EXPLORE_MAX_DEPTH * 2 + 8];
+    if (p.goal.kind != GOAL_NONE) {
+        if (r.goal_found) {
+            explore_path_format(&r.goal, path, sizeof(path));
+            printf("[*] goal reached holding each for %d frames: %s\n", p.hold, path);
+        } else {
+            printf("[*] goal not reached\n");
+        }
+    }
+    for (int i = 0; i < r.trap_count; i++) {
+        char text[24];
+        disasm(r.traps[i].op, profile_quirks(c8.profile), text, sizeof(text));
+        explore_path_format(&r.traps[i].how, path, sizeof(path));
+        printf("[!] %s at %03X (%s) via %s\n", trap_name(r.traps[i].trap), r.traps[i].pc, text, path);
+    }
+    if (r.dead_ends) {
+        explore_path_format(&r.dead_end, path, sizeof(path));
+        printf("[!] %llu dead ends, the first via %s\n", (unsigned long long) r.dead_ends, path);
+    }
+    return r.trap_count || r.dead_ends ? 2 : 0;
+}
+
+// tas: record a movie of random input, then edit and seek around it the way a piano
+// roll does, timing the seeks and checking them against a straight replay
+static int cmd_tas(int argc, char **argv) {
+    if (argc < 1) return -1;
+    long frames = 100000;
+    size_t budget = TAS_BUDGET;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return -1;
+        long value = strtol(argv[i + 1], NULL, 10);
+        if (!strcmp(argv[i], "--frames")) {
+            frames = value;
+        } else if (!strcmp(argv[i], "--budget")) {
+            budget = (size_t) value << 20;
+        } else {
+            return -1;
+        }
+        i++;
+    }
+    if (frames < 1) return -1;
+
+    static chip_8 c8, replay;
+    static tas_movie movie;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    c8.running = true;
+    if (!tas_init(&movie, &c8, STEPS_PER_FRAME, budget)) return 1;
+
+    uint32_t rng = 1;
+    uint16_t keys = 0;
+    long held = 0;
+    double start = perf_now();
+    for (long f = 0; f < frames; f++) {
+        if (held-- <= 0) {
+            rng = rng * 1103515245 + 12345;
+            keys = (rng >> 12) & 1 ? 1 << ((rng >> 16) & 0xf) : 0;
+            held = (rng >> 20) & 0x3f;
+        }
+        tas_set_keys(&movie, (uint32_t) f, keys);
+        tas_seek(&movie, (uint32_t) f + 1);
+    }
+    printf("[*] recorded %ld frames in %.3fs, %d states every %u frames, %.1f MiB\n", frames, perf_now() - start,
+           movie.zone_count, movie.interval, tas_memory(&movie) / 1048576.0);
+
+    // edits land near the cursor, the way they do in an editor, with the odd far jump
+    double worst = 0, total = 0;
+    int seeks = 0, mismatches = 0;
+    for (int i = 0; i < 2000; i++) {
+        rng = rng * 1103515245 + 12345;
+        uint32_t target = (rng >> 8) % (uint32_t) frames;
+        if (i % 16) {
+            int32_t near = (int32_t) ((rng >> 4) % 512) - 256;
+            int64_t t = (int64_t) movie.cursor + near;
+            target = t < 0 ? 0 : t >= frames ? (uint32_t) frames - 1 : (uint32_t) t;
+        }
+        if (i % 4 == 0) {
+            uint32_t edited = target > 32 ? target - (rng >> 24) % 32 : target;
+            tas_set_keys(&movie, edited, tas_keys(&movie, edited) ^ (1 << ((rng >> 20) & 0xf)));
+        }
+        double seek_start = perf_now();
+        tas_seek(&movie, target);
+        double ms = (perf_now() - seek_start) * 1000.0;
+        total += ms;
+        worst = ms > worst ? ms : worst;
+        seeks++;
+        if (i % 200 == 0) {
+            replay = movie.origin;
+            for (uint32_t f = 0; f < target; f++) {
+                begin_frame(&replay, tas_keys(&movie, f));
+                run_steps(&replay, STEPS_PER_FRAME, NULL, NULL);
+            }
+            if (machine_hash(&replay) != machine_hash(&movie.now)) {
+                fprintf(stderr, "[!] seek to frame %u differs from a straight replay\n", target);
+                mismatches++;
+            }
+        }
+    }
+    printf("[*] %d seeks: %.3fms average, %.3fms worst, %llu frames re-simulated\n", seeks, total / seeks, worst,
+           (unsigned long long) movie.resimulated);
+    printf("[*] greenzone: %d states every %u frames, %.1f MiB of %.1f MiB, %.1f MiB in all\n", movie.zone_count,
+           movie.interval, movie.zone_bytes / 1048576.0, budget / 1048576.0, tas_memory(&movie) / 1048576.0);
+    tas_free(&movie);
+    return mismatches ? 1 : 0;
+}
+
+// fuzz: mutate the given ROMs in-process, for throughput numbers and a quick look at
+// what traps before handing the corpus to orca-fuzz. inputs whose state hashes go wrong
+// are written out as hash-<n>.bin for replaying there.
+static int cmd_fuzz(int argc, char **argv) {
+    long runs = 1000000;
+    uint32_t rng = 1;
+    int seeds = 0;
+    static uint8_t corpus[8][FUZZ_HEADER + MEMORY_SIZE];
+    static size_t corpus_size[8];
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (uint32_t) strtoul(argv[++i], NULL, 10);
+        } else if (seeds < 8) {
+            static chip_8 c8;
+            init(&c8);
+            if (!load_rom_arg(&c8, argv[i])) return 1;
+            size_t size = MEMORY_SIZE - PRG_ADDR;
+            while (size && !c8.memory[PRG_ADDR + size - 1]) size--;
+            corpus_size[seeds] = fuzz_input(c8.memory + PRG_ADDR, size, PROFILE_VIP, corpus[seeds], sizeof(corpus[0]));
+            seeds++;
+        } else {
+            return -1;
+        }
+    }
+    if (!seeds || runs < 1) return -1;
+
+    static chip_8 template, c8;
+    static uint8_t input[FUZZ_HEADER + FUZZ_MAX_SCRIPT * 2 + MEMORY_SIZE];
+    fuzz_template(&template);
+    long traps[TRAP_COUNT] = {0};
+    int bad_hashes = 0;
+    uint64_t cycles = 0;
+    double start = perf_now();
+    for (long r = 0; r < runs; r++) {
+        rng = rng * 1103515245 + 12345;
+        int seed = (rng >> 8) % seeds;
+        size_t size = corpus_size[seed];
+        memcpy(input, corpus[seed], size);
+        fuzz_mutate(input, size, &rng);
+        fuzz_outcome out;
+        fuzz_one(&template, &c8, input, size, &out);
+        traps[out.trap]++;
+        cycles += out.cycles;
+        if (!out.hash_ok && bad_hashes < 16) {
+            char name[32];
+            snprintf(name, sizeof(name), "hash-%d.bin", bad_hashes++);
+            write_file(name, input, (int) size);
+            fprintf(stderr, "[!] state hash drifted, input written to %s\n", name);
+        }
+    }
+    double seconds = perf_now() - start;
+    printf("[*] %ld runs in %.3fs, %.0f runs/s, %.1fM instructions/s\n", runs, seconds, runs / seconds,
+           cycles / seconds / 1e6);
+    for (int k = 0; k < TRAP_COUNT; k++) {
+        if (traps[k]) printf("[*] %-16s %ld\n", trap_name(k), traps[k]);
+    }
+    return bad_hashes ? 2 : 0;
+}
+
+// diff: run an engine against the reference in lockstep on every given ROM under
+// every profile, plus mutated copies of them, and report the first instruction each
+// disagrees on. --self-test first checks the checker against an engine with a planted
+// superinstruction bug.
+static int cmd_diff(int argc, char **argv) {
+    if (argc < 2) return -1;
+    const engine *candidate = engine_find(argv[0]);
+    if (!candidate) {
+        fprintf(stderr, "[!] unknown engine %s, one of:\n", argv[0]);
+        for (int i = 0; i < engine_count; i++) {
+            fprintf(stderr, "    %-8s %s\n", engines[i].name, engines[i].about);
+        }
+        return 1;
+    }
+    uint32_t frames = 3000;
+    int interval = DIFF_INTERVAL;
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    long fuzzed = 0;
+    bool self_test = false;
+    int rom_count = 0;
+    const char *roms[64];
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--strict")) {
+            interval = 1;
+        } else if (!strcmp(argv[i], "--self-test")) {
+            self_test = true;
+        } else if (argv[i][0] != '-' || argv[i][1] != '-') {
+            if (rom_count == 64) return -1;
+            roms[rom_count++] = argv[i];
+        } else if (i + 1 >= argc) {
+            return -1;
+        } else {
+            long value = strtol(argv[i + 1], NULL, 10);
+            if (!strcmp(argv[i], "--frames")) {
+                frames = (uint32_t) value;
+            } else if (!strcmp(argv[i], "--every")) {
+                interval = (int) value;
+            } else if (!strcmp(argv[i], "--threads")) {
+                threads = (int) value;
+            } else if (!strcmp(argv[i], "--fuzz")) {
+                fuzzed = value;
+            } else {
+                return -1;
+            }
+            i++;
+        }
+    }
+    if (!rom_count || !frames || interval < 1 || fuzzed < 0) return -1;
+
+    int count = rom_count * PROFILE_COUNT + (int) fuzzed;
+    diff_job *jobs = calloc(count, sizeof(diff_job));
+    uint16_t *keys = calloc((size_t) rom_count * PROFILE_COUNT * frames + (size_t) fuzzed * FUZZ_FRAMES, sizeof(uint16_t));
+    if (!jobs || !keys) {
+        fprintf(stderr, "[!] failed to allocate %d jobs\n", count);
+        free(jobs);
+        free(keys);
+        return 1;
+    }
+    static chip_8 c8, template;
+    static uint8_t seeds[64][FUZZ_HEADER + MEMORY_SIZE], input[FUZZ_HEADER + MEMORY_SIZE];
+    static size_t seed_size[64];
+    uint16_t *next_keys = keys;
+    int n = 0;
+    uint32_t rng = 1;
+    for (int r = 0; r < rom_count; r++) {
+        init(&c8);
+        if (!load_rom_arg(&c8, roms[r])) {
+            free(jobs);
+            free(keys);
+            return 1;
+        }
+        c8.running = true;
+        size_t size = MEMORY_SIZE - PRG_ADDR;
+        while (size && !c8.memory[PRG_ADDR + size - 1]) size--;
+        seed_size[r] = fuzz_input(c8.memory + PRG_ADDR, size, PROFILE_VIP, seeds[r], sizeof(seeds[0]));
+        for (int p = 0; p < PROFILE_COUNT; p++, n++) {
+            diff_job *job = &jobs[n];
+            const char *base = strrchr(roms[r], '/');
+            snprintf(job->name, sizeof(job->name), "%s (%s)", base ? base + 1 : roms[r], profile_name(p));
+            job->start = c8;
+            job->start.profile = p;
+            job->steps_per_frame = STEPS_PER_FRAME;
+            job->frames = frames;
+            job->keys = next_keys;
+            next_keys += frames;
+            // pseudo-random presses, each held for a while
+            uint16_t held_keys = 0;
+            long held = 0;
+            for (uint32_t f = 0; f < frames; f++) {
+                if (held-- <= 0) {
+                    rng = rng * 1103515245 + 12345;
+                    held_keys = (rng >> 12) & 1 ? 1 << ((rng >> 16) & 0xf) : 0;
+                    held = (rng >> 20) & 0x3f;
+                }
+                job->keys[f] = held_keys;
+            }
+        }
+    }
+    fuzz_template(&template);
+    for (long i = 0; i < fuzzed; i++, n++) {
+        diff_job *job = &jobs[n];
+        int r = (int) (i % rom_count);
+        memcpy(input, seeds[r], seed_size[r]);
+        fuzz_mutate(input, seed_size[r], &rng);
+        int length;
+        const uint8_t *script = fuzz_load(&template, &job->start, input, seed_size[r], &length);
+        snprintf(job->name, sizeof(job->name), "fuzz %ld of %s", i, roms[r]);
+        job->steps_per_frame = STEPS_PER_FRAME;
+        job->frames = FUZZ_FRAMES;
+        job->keys = next_keys;
+        next_keys += FUZZ_FRAMES;
+        for (uint32_t f = 0; f < FUZZ_FRAMES; f++) {
+            job->keys[f] = fuzz_keys(script, length, f);
+        }
+    }
+
+    if (self_test) {
+        // in strict mode, on the same runs, and pinned on the pair's first load
+        int caught = diff_batch(&diff_planted, jobs, count, 1, threads), pinned = 0;
+        for (int i = 0; i < count; i++) {
+            pinned += jobs[i].diverged && jobs[i].op >> 12 == 0x6;
+        }
+        if (!caught) fprintf(stderr, "[!] self-test: no run loads two registers in a row for the planted bug to show\n");
+        if (pinned < caught) {
+            fprintf(stderr, "[!] self-test: %d of %d runs were caught away from the planted 6XNN pair\n",
+                    caught - pinned, caught);
+        }
+        if (!caught || pinned < caught) {
+            free(jobs);
+            free(keys);
+            return 2;
+        }
+        printf("[*] self-test: strict mode caught the planted 6XNN pair bug in %d of %d runs\n", caught, count);
+    }
+
+    double start = perf_now();
+    int failed = diff_batch(candidate, jobs, count, interval, threads);
+    double seconds = perf_now() - start;
+    uint64_t instructions = 0;
+    for (int i = 0; i < count; i++) {
+        instructions += jobs[i].instructions;
+        if (jobs[i].diverged) fprintf(stderr, "[!] %s: %s", jobs[i].name, jobs[i].report);
+    }
+    printf("[*] %s against step: %d of %d runs agree, %llu instructions compared every %d in %.3fs\n",
+           candidate->name, count - failed, count, (unsigned long long) instructions, interval, seconds);
+    free(jobs);
+    free(keys);
+    return failed ? 2 : 0;
+}
+
+// cfg: recover a ROM's control flow without running it and print the annotated listing
+static int cmd_cfg(int argc, char **argv) {
+    if (argc < 1) return -1;
+    quirk_profile profile = PROFILE_VIP;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (parse_profile_arg(argc, argv, &i, &profile, &ok)) {
+            if (!ok) return 1;
+        } else if (!strcmp(argv[i], "--summary")) {
+            quiet = true;
+        } else {
+            return -1;
+        }
+    }
+    static chip_8 c8;
+    static cfg g;
+    init(&c8);
+    if (!load_rom_arg(&c8, argv[0])) return 1;
+    c8.profile = profile;
+    double start = perf_now();
+    cfg_build(&g, &c8);
+    double ms = (perf_now() - start) * 1000.0;
+
+    static const char *ends[] = {"falls", "jumps", "branches", "calls", "returns", "indirect", "halts", "traps"};
+    for (int i = 0; i < g.block_count && !quiet; i++) {
+        const cfg_block *b = &g.blocks[i];
+        printf("\n%03X-%03X %s", b->start, b->end - 1, ends[b->kind]);
+        for (int k = 0; k < b->succ_count; k++) {
+            printf(" %03X", b->succ[k]);
+        }
+        if (g.flags[b->start] & CFG_CALL_TARGET) printf(", subroutine");
+        if (g.flags[b->start] & CFG_LOOP_HEAD) printf(", loop head");
+        if (b->loop_depth) printf(", loop depth %d", b->loop_depth);
+        if (b->idle) printf(", idle");
+        printf("\n");
+        for (uint16_t a = b->start; a < b->end; a += 2) {
+            char text[24];
+            disasm(opcode_at(&c8, a), profile_quirks(c8.profile), text, sizeof(text));
+            printf("    %03X  %04X  %s%s\n", a, opcode_at(&c8, a), text,
+                   g.flags[a] & CFG_WRITTEN ? "    ; overwritten" : "");
+        }
+    }
+    // data runs, as the addresses DXYN and FX65 were seen reading
+    for (int a = 0; a < MEMORY_SIZE && !quiet;) {
+        if (!(g.flags[a] & CFG_DATA) || (g.flags[a] & (CFG_CODE | CFG_OPERAND))) {
+            a++;
+            continue;
+        }
+        int end = a;
+        while (end < MEMORY_SIZE && (g.flags[end] & CFG_DATA) && !(g.flags[end] & (CFG_CODE | CFG_OPERAND))) end++;
+        printf("\n%03X-%03X data", a, end - 1);
+        for (int k = a; k < end; k++) {
+            if ((k - a) % 16 == 0) printf("\n    %03X ", k);
+            printf(" %02X", c8.memory[k]);
+        }
+        printf("\n");
+        a = end;
+    }
+    if (!quiet) printf("\n");
+
+    for (int i = 0; i < g.indirect_count; i++) {
+        printf("[!] indirect jump at %03X\n", g.indirect[i]);
+    }
+    for (int i = 0; i < g.self_mod_count; i++) {
+        printf("[!] %03X writes over code at %03X\n", g.self_mod[i].site, g.self_mod[i].target);
+    }
+    int subroutines = 0;
+    for (int a = 0; a < MEMORY_SIZE; a++) {
+        subroutines += (g.flags[a] & CFG_CALL_TARGET) != 0;
+    }
+    printf("[*] %d code bytes, %d data bytes, %d blocks, %d subroutines, %d call sites, %d loops (%d idle) in %.3fms%s\n",
+           g.code_bytes, g.data_bytes, g.block_count, subroutines, g.call_count, g.loops, g.idle_loops, ms,
+           g.truncated ? ", truncated" : "");
+    return 0;
+}
+
+// detect: pick a quirk profile for each ROM and record it in the database
+static int cmd_detect(int argc, char **argv) {
+    long frames = DETECT_FRAMES;
+    const char *db = DETECT_DB;
+    bool dry_run = false;
+    int roms = 0, failed = 0;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--db") && i + 1 < argc) {
+            db = argv[++i];
+        } else if (!strcmp(argv[i], "--dry-run")) {
+            dry_run = true;
+        }
+    }
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") || !strcmp(argv[i], "--db")) {
+            i++;
+            continue;
+        }
+        if (!strcmp(argv[i], "--dry-run")) continue;
+        roms++;
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp) {
+            fprintf(stderr, "[!] failed to open %s\n", argv[i]);
+            failed++;
+            continue;
+        }
+        static uint8_t rom[MEMORY_SIZE];
+        long size = (long) fread(rom, 1, sizeof(rom), fp);
+        fclose(fp);
+        if (size > MEMORY_SIZE - PRG_ADDR) {
+            fprintf(stderr, "[!] %s is too large\n", argv[i]);
+            failed++;
+            continue;
+        }
+
+        detect_result result;
+        double start = perf_now();
+        if (!detect_profile(rom, size, frames, &result)) return 1;
+        uint8_t digest[SHA1_SIZE];
+        char hex[SHA1_HEX_SIZE];
+        sha1(rom, size, digest);
+        sha1_hex(digest, hex);
+
+        printf("[*] %s (%s): %s%s, %.0fms\n", argv[i], hex, profile_name(result.best),
+               result.agnostic ? " (any profile works)" : "", (perf_now() - start) * 1000.0);
+        if (result.diverged_frame >= 0) printf("    profiles diverge at frame %ld\n", result.diverged_frame);
+        for (int p = 0; p < PROFILE_COUNT; p++) {
+            const profile_run *run = &result.runs[p];
+            printf("    %-7s score %5d  hints %3d", profile_name(p), run->score, run->hint);
+            if (run->trap != TRAP_NONE) printf("  %s at frame %ld", trap_name(run->trap), run->trap_frame);
+            if (run->stalled) printf("  stalled");
+            printf("\n");
+        }
+        const char *name = strrchr(argv[i], '/');
+        if (!dry_run && !quirkdb_store(db, hex, result.best, name ? name + 1 : argv[i])) failed++;
+    }
+    if (roms == 0) return -1;
+    return failed ? 1 : 0;
+}
+
+// scan: build the ROM library catalogue from a directory tree
+static int cmd_scan(int argc, char **argv) {
+    if (argc < 1) return -1;
+    const char *catalogue = LIBRARY_CATALOGUE;
+    long frames = LIBRARY_FRAMES;
+    // detection already runs one thread per profile for every ROM
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > PROFILE_COUNT ? (int) (cpus / PROFILE_COUNT) : 1;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return -1;
+        if (!strcmp(argv[i], "--catalogue")) {
+            catalogue = argv[++i];
+        } else if (!strcmp(argv[i], "--threads")) {
+            threads = (int) strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--frames")) {
+            frames = strtol(argv[++i], NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+    return library_scan(argv[0], catalogue, threads, frames) ? 0 : 1;
+}
+
+// list: print the catalogue, with thumbnails for --thumbs
+static int cmd_list(int argc, char **argv) {
+    const char *catalogue = LIBRARY_CATALOGUE;
+    bool thumbs = false;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--thumbs")) {
+            thumbs = true;
+        } else {
+            catalogue = argv[i];
+        }
+    }
+    static library lib;
+    double start = perf_now();
+    if (!library_open(&lib, catalogue)) {
+        fprintf(stderr, "[!] failed to open %s\n", catalogue);
+        return 1;
+    }
+    printf("[*] %u ROMs, opened in %.3fms\n", lib.count, (perf_now() - start) * 1000.0);
+    for (uint32_t i = 0; i < lib.count; i++) {
+        const library_entry *e = &lib.entries[i];
+        char hex[SHA1_HEX_SIZE];
+        sha1_hex(e->sha1, hex);
+        printf("%.12s %5u %-6s %-6s %6u ips  %s", hex, e->size, profile_name(e->platform), profile_name(e->profile),
+               e->ips, e->path);
+        if (e->trap != TRAP_NONE) printf("  (%s)", trap_name(e->trap));
+        printf("\n");
+        for (int y = 0; thumbs && y < SCREEN_HEIGHT; y += 2) {
+            // two pixel rows per line of text
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                int top = thumb_pixel(e, x, y), bottom = thumb_pixel(e, x, y + 1);
+                fputs(top && bottom ? "█" : top ? "▀" : bottom ? "▄" : " ", stdout);
+            }
+            printf("\n");
+        }
+    }
+    library_close(&lib);
+    return 0;
+}
+
+static const command commands[] = {
+    {"run", cmd_run, "run <rom|gen:kind> [frames] [--watchdog N] [--spf N] [--input events.txt] [--profile vip|schip|xochip]"},
+    {"bench", cmd_bench, "bench <rom|gen:kind> [--frames N] [--instances N [--slice N] [--shared]] [--counters] [--run-ahead 0-3] [--profile vip|schip|xochip]"},
+    {"debug", cmd_debug, "debug <rom|gen:kind> [--frames N] [--max-hits N] [--break addr] [--break-if vX==N[@addr]] [--watch addr[-addr]]"},
+    {"rewind", cmd_rewind, "rewind <rom|gen:kind> [frames]"},
+    {"boot", cmd_boot, "boot <rom|gen:kind> [--profile vip|schip|xochip] [--dir path]"},
+    {"netplay", cmd_netplay, "netplay <rom|gen:kind> <player 1|2> <port> <peer host[:port]> [--frames N] [--fps N] [--loss percent] [--profile vip|schip|xochip]"},
+    {"explore", cmd_explore, "explore <rom|gen:kind> [--depth N] [--beam N] [--hold frames] [--threads N] [--keys mask] [--goal trap|mem:addr=value|pixel:x,y|pc:addr] [--no-boot] [--profile vip|schip|xochip]"},
+    {"tas", cmd_tas, "tas <rom|gen:kind> [--frames N] [--budget MiB]"},
+    {"fuzz", cmd_fuzz, "fuzz <rom|gen:kind>... [--runs N] [--seed N]"},
+    {"diff", cmd_diff, "diff <engine> <rom|gen:kind>... [--frames N] [--every N | --strict] [--self-test] [--fuzz N] [--threads N]"},
+    {"cfg", cmd_cfg, "cfg <rom|gen:kind> [--summary] [--profile vip|schip|xochip]"},
+    {"detect", cmd_detect, "detect <rom>... [--frames N] [--db path] [--dry-run]"},
+    {"scan", cmd_scan, "scan <dir> [--catalogue path] [--threads N] [--frames N]"},
+    {"list", cmd_list, "list [catalogue] [--thumbs]"},
+    {"asm", cmd_asm, "asm <source.8o> <out.ch8>"},
+    {"gen", cmd_gen, "gen <alu|draw|calls|bulk|selfmod> <out.ch8> [--source] [--unroll N] [--height N] [--depth N] [--regs N] [--seed N]"},
+};
+
+static void usage(void) {
+    fprintf(stderr, "usage:\n");
+    for (size_t i = 0; i < sizeof(commands) / sizeof(*commands); i++) {
+        fprintf(stderr, "    orca-headless %s\n", commands[i].usage);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(commands) / sizeof(*commands); i++) {
+        if (!strcmp(argv[1], commands[i].name)) {
+            int rc = commands[i].run(argc - 2, argv + 2);
+            if (rc < 0) {
+                fprintf(stderr, "usage: orca-headless %s\n", commands[i].usage);
+                return 1;
+            }
+            return rc;
+        }
+    }
+    usage();
+    return 1;
+}
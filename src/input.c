@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <input.h>
+#include <cpu.h>
+
+// timestamped input. a host that only latched keys at frame boundaries would lose a
+// key pressed and released between two of them, and FX0A would wait a frame to see
+// any release. here each change of keys lands at its own instruction, so a batch is
+// split wherever an event falls. the timestamps count emulated instructions rather
+// than host time, so replaying the same events reproduces the same run.
+
+bool input_push(input_queue *q, key_event e) {
+    if (q->tail - q->head == INPUT_QUEUE_SIZE) return false;
+    q->events[q->tail++ % INPUT_QUEUE_SIZE] = e;
+    return true;
+}
+
+// the oldest event, if it is due `done` instructions into a frame of `steps`. an event
+// at or past the end of its frame belongs to the next frame's boundary, like events
+// left over from a frame cut short by a breakpoint or a stop: all are due at once.
+static const key_event *due(const input_queue *q, uint32_t frame, int done, int steps) {
+    if (q->head == q->tail) return NULL;
+    const key_event *e = &q->events[q->head % INPUT_QUEUE_SIZE];
+    return e->frame < frame || (e->frame == frame && e->step <= done && e->step < steps) ? e : NULL;
+}
+
+// instructions until the next event in this frame, at most `left`
+static int until_next(const input_queue *q, uint32_t frame, int done, int left) {
+    if (q->head == q->tail) return left;
+    const key_event *e = &q->events[q->head % INPUT_QUEUE_SIZE];
+    if (e->frame != frame || e->step - done >= left) return left;
+    return e->step - done;
+}
+
+static void apply(chip_8 *c, uint16_t keys, rewind_log *r) {
+    // a change to the keys already held would only forget the latched release
+    if (keys == c->keycur) return;
+    if (r) {
+        rewind_key_event(r, c, keys);
+    } else {
+        set_keys(c, keys);
+    }
+}
+
+// run frame `frame`: the boundary, then up to `steps` instructions with the queued
+// events for it applied at their step. the first event due at the boundary is
+// latched by the boundary itself, so input that only changes there is recorded and
+// behaves as with begin_frame(). dbg, idle and r may be NULL; with r the frame is
+// recorded for rewind. returns the number of instructions executed.
+int input_run_frame(chip_8 *c, input_queue *q, uint32_t frame, int steps, debugger *dbg, uint32_t *idle,
+                    rewind_log *r) {
+    uint16_t keys = c->keycur;
+    const key_event *e = due(q, frame, 0, steps);
+    if (e) {
+        keys = e->keys;
+        q->head++;
+    }
+    if (r) {
+        rewind_begin_frame(r, c, keys);
+    } else {
+        begin_frame(c, keys);
+    }
+    // nothing is applied after the last instruction, so rewind never sees a record
+    // trailing its frame
+    int done = 0;
+    while (done < steps && c->running) {
+        while ((e = due(q, frame, done, steps))) {
+            apply(c, e->keys, r);
+            q->head++;
+        }
+        int want = until_next(q, frame, done, steps - done);
+        int ran = run_steps(c, want, dbg, idle);
+        if (r) rewind_add_steps(r, c, ran);
+        done += ran;
+        if (ran < want) break;
+    }
+    return done;
+}
+
+// one event per line: frame, step and the keys as four hex digits
+void input_write_header(FILE *fp, input_header h) {
+    fprintf(fp, "orca-input %s %d\n", profile_name(h.profile), h.steps_per_frame);
+}
+
+void input_write(FILE *fp, key_event e) {
+    fprintf(fp, "%u %u %04x\n", e.frame, e.step, e.keys);
+}
+
+// the header and every event of a file written by input_write_header() and
+// input_write(), in order. returns NULL, with a message, if the file is malformed,
+// out of order or has an event past the end of its frame.
+key_event *input_read(FILE *fp, input_header *h, uint32_t *count) {
+    char name[16];
+    if (fscanf(fp, "orca-input %15s %d", name, &h->steps_per_frame) != 2 || !profile_parse(name, &h->profile) ||
+        h->steps_per_frame < 1 || h->steps_per_frame > UINT16_MAX) {
+        fprintf(stderr, "[!] input has no valid \"orca-input <profile> <steps per frame>\" header\n");
+        return NULL;
+    }
+    uint32_t capacity = 256;
+    key_event *events = malloc(capacity * sizeof(key_event));
+    *count = 0;
+    unsigned frame, step, keys;
+    int line = 0, got;
+    while (events && (got = fscanf(fp, "%u %u %x", &frame, &step, &keys)) == 3) {
+        line++;
+        key_event e = {frame, (uint16_t) step, (uint16_t) keys};
+        if (step >= (unsigned) h->steps_per_frame || keys > UINT16_MAX ||
+            (*count && (frame < events[*count - 1].frame ||
+                        (frame == events[*count - 1].frame && step < events[*count - 1].step)))) {
+            fprintf(stderr, "[!] input event %d is out of range or out of order\n", line);
+            free(events);
+            return NULL;
+        }
+        if (*count == capacity) {
+            key_event *grown = realloc(events, capacity * 2 * sizeof(key_event));
+            if (!grown) break;
+            events = grown;
+            capacity *= 2;
+        }
+        events[(*count)++] = e;
+    }
+    if (!events || got != EOF) {
+        fprintf(stderr, "[!] failed to read input event %d\n", line + 1);
+        free(events);
+        return NULL;
+    }
+    return events;
+}
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <library.h>
+#include <detect.h>
+#include <cpu.h>
+#include <perf.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#define LIBRARY_MMAP 1
+#endif
+
+// ROM library: a scan hashes, classifies and test-runs every ROM under a directory and
+// writes one fixed-size record per ROM. opening the catalogue is a single mmap, so
+// startup costs the same for ten ROMs or ten thousand, and lookups are a binary search.
+
+static const char library_magic[8] = "ORCALIB";
+
+bool library_open(library *lib, const char *path) {
+    memset(lib, 0, sizeof(*lib));
+#ifdef LIBRARY_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(library_header)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    size_t size = st.st_size;
+#else
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    fseek(fp, 0L, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    void *map = size >= (long) sizeof(library_header) ? malloc(size) : NULL;
+    if (!map || fread(map, 1, size, fp) != (size_t) size) {
+        free(map);
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+#endif
+    lib->map = map;
+    lib->map_size = size;
+    const library_header *h = map;
+    if (memcmp(h->magic, library_magic, sizeof(library_magic)) || h->version != LIBRARY_VERSION ||
+        h->entry_size != sizeof(library_entry) ||
+        (size - sizeof(library_header)) / sizeof(library_entry) < h->count) {
+        fprintf(stderr, "[!] %s is not a catalogue this version can read, scan again\n", path);
+        library_close(lib);
+        return false;
+    }
+    lib->entries = (const library_entry *) (h + 1);
+    lib->count = h->count;
+    return true;
+}
+
+void library_close(library *lib) {
+    if (lib->map) {
+#ifdef LIBRARY_MMAP
+        munmap(lib->map, lib->map_size);
+#else
+        free(lib->map);
+#endif
+    }
+    memset(lib, 0, sizeof(*lib));
+}
+
+const library_entry *library_find(const library *lib, const uint8_t sha1[SHA1_SIZE]) {
+    uint32_t lo = 0, hi = lib->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(lib->entries[mid].sha1, sha1, SHA1_SIZE);
+        if (cmp == 0) return &lib->entries[mid];
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+// typical speeds: the VIP's, SUPER-CHIP on an HP 48, and Octo's XO-CHIP default
+uint32_t platform_ips(uint8_t platform) {
+    switch (platform) {
+        case PROFILE_SCHIP: return 30 * 60;
+        case PROFILE_XOCHIP: return 1000 * 60;
+        default: return STEPS_PER_FRAME * 60;
+    }
+}
+
+const char *library_name(const library_entry *e) {
+    const char *slash = strrchr(e->path, '/');
+    return slash ? slash + 1 : e->path;
+}
+
+static bool is_rom_name(const char *name) {
+    static const char *extensions[] = {".ch8", ".c8", ".sc8", ".xo8"};
+    const char *dot = strrchr(name, '.');
+    if (!dot) return false;
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(*extensions); i++) {
+        if (!strcasecmp(dot, extensions[i])) return true;
+    }
+    return false;
+}
+
+typedef struct {
+    char **paths;
+    int count;
+    int capacity;
+    struct {
+        dev_t dev;
+        ino_t ino;
+    } *dirs; // directories already walked, so a symlink back up doesn't loop
+    int dir_count;
+    int dir_capacity;
+} path_list;
+
+// false if the directory was walked already, or can't be remembered
+static bool first_visit(path_list *list, const struct stat *st) {
+    for (int i = 0; i < list->dir_count; i++) {
+        if (list->dirs[i].dev == st->st_dev && list->dirs[i].ino == st->st_ino) return false;
+    }
+    if (list->dir_count == list->dir_capacity) {
+        int capacity = list->dir_capacity ? list->dir_capacity * 2 : 64;
+        void *grown = realloc(list->dirs, capacity * sizeof(*list->dirs));
+        if (!grown) return false;
+        list->dirs = grown;
+        list->dir_capacity = capacity;
+    }
+    list->dirs[list->dir_count].dev = st->st_dev;
+    list->dirs[list->dir_count].ino = st->st_ino;
+    list->dir_count++;
+    return true;
+}
+
+static void collect(const char *dir, path_list *list) {
+    struct stat st;
+    if (stat(dir, &st) != 0 || !first_visit(list, &st)) return;
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        char path[LIBRARY_PATH_SIZE];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, e->d_name) >= (int) sizeof(path)) continue;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            collect(path, list);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || !is_rom_name(e->d_name) || st.st_size > MEMORY_SIZE - PRG_ADDR) continue;
+        if (list->count == list->capacity) {
+            int capacity = list->capacity ? list->capacity * 2 : 256;
+            char **grown = realloc(list->paths, capacity * sizeof(char *));
+            if (!grown) break;
+            list->paths = grown;
+            list->capacity = capacity;
+        }
+        list->paths[list->count++] = strdup(path);
+    }
+    closedir(d);
+}
+
+typedef struct {
+    const path_list *list;
+    library_entry *entries;
+    bool *ok;
+    long frames;
+    atomic_int next;
+    atomic_int done;
+} scan_job;
+
+static bool scan_one(const char *path, long frames, library_entry *e) {
+    memset(e, 0, sizeof(*e));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    uint8_t rom[MEMORY_SIZE];
+    long size = (long) fread(rom, 1, sizeof(rom), fp);
+    fclose(fp);
+    if (size <= 0 || size > MEMORY_SIZE - PRG_ADDR) return false;
+
+    sha1(rom, size, e->sha1);
+    e->size = size;
+    strncpy(e->path, path, sizeof(e->path) - 1);
+    detect_result result;
+    if (!detect_profile(rom, size, frames, &result)) return false;
+    e->platform = result.platform;
+    e->profile = result.best;
+    e->ips = platform_ips(result.platform);
+
+    chip_8 *c = chip_alloc();
+    if (!c) return false;
+    init(c);
+    load_buffer(c, rom, size);
+    c->profile = result.best;
+    c->running = true;
+    int steps = e->ips / 60;
+    for (long f = 0; f < frames && c->running; f++) {
+        begin_frame(c, 0);
+        run_steps(c, steps, NULL, NULL);
+    }
+    e->trap = c->trap;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int bit = y * SCREEN_WIDTH + x;
+            if (c->display[x][y]) e->thumb[bit / 8] |= 0x80 >> (bit % 8);
+        }
+    }
+    free(c);
+    return true;
+}
+
+static void *scan_thread(void *arg) {
+    scan_job *job = arg;
+    int i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->list->count) {
+        job->ok[i] = scan_one(job->list->paths[i], job->frames, &job->entries[i]);
+        int done = atomic_fetch_add(&job->done, 1) + 1;
+        if (done % 100 == 0) printf("[*] scanned %d/%d\n", done, job->list->count);
+    }
+    return NULL;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const library_entry *x = a, *y = b;
+    int cmp = memcmp(x->sha1, y->sha1, SHA1_SIZE);
+    return cmp ? cmp : strcmp(x->path, y->path);
+}
+
+static bool write_catalogue(const char *catalogue, const library_entry *entries, uint32_t count) {
+    char tmp[LIBRARY_PATH_SIZE + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", catalogue);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        fprintf(stderr, "[!] failed to open %s for writing\n", tmp);
+        return false;
+    }
+    library_header h = {{0}, LIBRARY_VERSION, count, sizeof(library_entry), 0};
+    memcpy(h.magic, library_magic, sizeof(h.magic));
+    bool written = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(entries, sizeof(library_entry), count, fp) == count;
+    // written next to the old one and renamed over it, so readers never map a partial file
+    if (fclose(fp) != 0 || !written || rename(tmp, catalogue) != 0) {
+        fprintf(stderr, "[!] failed to write %s\n", catalogue);
+        return false;
+    }
+    return true;
+}
+
+// scan every ROM under `dir` on `threads` workers (each also runs one thread per
+// profile for detection) and replace the catalogue with the result
+bool library_scan(const char *dir, const char *catalogue, int threads, long frames) {
+    path_list list = {0};
+    collect(dir, &list);
+    qsort(list.paths, list.count, sizeof(char *), compare_paths);
+    printf("[*] found %d ROMs under %s\n", list.count, dir);
+
+    library_entry *entries = calloc(list.count ? list.count : 1, sizeof(library_entry));
+    bool *ok = calloc(list.count ? list.count : 1, sizeof(bool));
+    pthread_t *workers = calloc(threads > 1 ? threads : 1, sizeof(pthread_t));
+    bool result = entries && ok && workers;
+    if (!result) fprintf(stderr, "[!] failed to allocate the catalogue\n");
+
+    if (result) {
+        scan_job job = {.list = &list, .entries = entries, .ok = ok, .frames = frames};
+        atomic_init(&job.next, 0);
+        atomic_init(&job.done, 0);
+        int started = 0;
+        double start = perf_now();
+        while (started < threads && pthread_create(&workers[started], NULL, scan_thread, &job) == 0) {
+            started++;
+        }
+        if (started == 0) scan_thread(&job);
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+
+        // drop failures and duplicate ROMs (same hash, keep the first path)
+        uint32_t count = 0;
+        for (int i = 0; i < list.count; i++) {
+            if (ok[i]) entries[count++] = entries[i];
+        }
+        qsort(entries, count, sizeof(library_entry), compare_entries);
+        uint32_t unique = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (unique && !memcmp(entries[unique - 1].sha1, entries[i].sha1, SHA1_SIZE)) continue;
+            entries[unique++] = entries[i];
+        }
+        result = write_catalogue(catalogue, entries, unique);
+        if (result) {
+            printf("[*] catalogued %u ROMs (%d skipped) in %.2fs\n", unique, list.count - (int) unique,
+                   perf_now() - start);
+        }
+    }
+
+    for (int i = 0; i < list.count; i++) {
+        free(list.paths[i]);
+    }
+    free(list.paths);
+    free(list.dirs);
+    free(entries);
+    free(ok);
+    free(workers);
+    return result;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <string.h>
+#include <libview.h>
+#include <cpu.h>
+#include <raygui.h>
+
+#define ROW_HEIGHT 44
+#define THUMB_SCALE 1
+#define FONT_SIZE 10
+
+// needs a GL context, so call it after InitWindow()
+void library_view_init(library_view *v, const library *lib) {
+    memset(v, 0, sizeof(*v));
+    v->lib = lib;
+    Image blank = GenImageColor(SCREEN_WIDTH, SCREEN_HEIGHT, BLACK);
+    ImageFormat(&blank, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+    for (int i = 0; i < LIBRARY_ROWS; i++) {
+        v->thumbs[i] = LoadTextureFromImage(blank);
+        v->shown[i] = -1;
+    }
+    UnloadImage(blank);
+}
+
+void library_view_free(library_view *v) {
+    for (int i = 0; i < LIBRARY_ROWS; i++) {
+        UnloadTexture(v->thumbs[i]);
+    }
+}
+
+static void upload_thumb(Texture2D texture, const library_entry *e) {
+    uint8_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            pixels[y * SCREEN_WIDTH + x] = thumb_pixel(e, x, y) ? 255 : 0;
+        }
+    }
+    UpdateTexture(texture, pixels);
+}
+
+// ROM browser: thumbnail, name, platform, quirks and speed per row. returns the
+// entry that was clicked, if any.
+const library_entry *draw_library_view(library_view *v, Rectangle bounds) {
+    const library *lib = v->lib;
+    Rectangle list = {bounds.x + 4, bounds.y + 28, bounds.width - 8, LIBRARY_ROWS * ROW_HEIGHT};
+    if (!lib->count) {
+        DrawText("no catalogue: run orca-headless scan <dir>", list.x + 4, list.y + 4, FONT_SIZE, DARKGRAY);
+        return NULL;
+    }
+    Vector2 mouse = GetMousePosition();
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0 && CheckCollisionPointRec(mouse, list)) {
+        int64_t top = (int64_t) v->top - (int64_t) wheel;
+        int64_t limit = lib->count > LIBRARY_ROWS ? lib->count - LIBRARY_ROWS : 0;
+        v->top = top < 0 ? 0 : top > limit ? limit : top;
+    }
+
+    v->uploaded = 0;
+    const library_entry *picked = NULL;
+    bool clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    for (int i = 0; i < LIBRARY_ROWS; i++) {
+        uint32_t index = v->top + i;
+        if (index >= lib->count) break;
+        const library_entry *e = &lib->entries[index];
+        if (v->shown[i] != index) {
+            upload_thumb(v->thumbs[i], e);
+            v->shown[i] = index;
+            v->uploaded++;
+        }
+        Rectangle row = {list.x, list.y + i * ROW_HEIGHT, list.width, ROW_HEIGHT};
+        if (CheckCollisionPointRec(mouse, row)) {
+            DrawRectangleRec(row, Fade(SKYBLUE, 0.5f));
+            if (clicked) picked = e;
+        }
+        DrawTextureEx(v->thumbs[i], (Vector2) {row.x + 4, row.y + 6}, 0, THUMB_SCALE, WHITE);
+        float text_x = row.x + 8 + SCREEN_WIDTH * THUMB_SCALE;
+        DrawText(library_name(e), text_x, row.y + 8, FONT_SIZE, DARKGRAY);
+        DrawText(TextFormat("%s, %s quirks, %u ips", profile_name(e->platform), profile_name(e->profile), e->ips),
+                 text_x, row.y + 22, FONT_SIZE, GRAY);
+        if (e->trap != TRAP_NONE) DrawText(trap_name(e->trap), text_x, row.y + 32, FONT_SIZE, MAROON);
+    }
+    DrawText(TextFormat("%u-%u of %u", v->top + 1, v->top + LIBRARY_ROWS < lib->count ? v->top + LIBRARY_ROWS : lib->count,
+                        lib->count), list.x + 4, list.y + list.height + 4, FONT_SIZE, DARKGRAY);
+    return picked;
+}
@@ -1,8 +1,25 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 #include <main.h>
-#include <opcodes.h>
+#include <cpu.h>
 #include <stdbool.h>
 #include <graphics.h>
+#include <perf.h>
+#include <trace.h>
+#include <debug.h>
+#include <debugview.h>
+#include <rewind.h>
+#include <detect.h>
+#include <library.h>
+#include <libview.h>
+#include <bootcache.h>
+#include <runahead.h>
+#include <netplay.h>
+#include <cfg.h>
+#include <tas.h>
+#include <tasview.h>
+#include <input.h>
 
 #define RAYGUI_IMPLEMENTATION
 #define RAYGUI_CUSTOM_ICONS
@@ -22,226 +39,195 @@
 KeyboardKey keyMapping[16] = {KEY_X, KEY_ONE, KEY_TWO, KEY_THREE, KEY_Q, KEY_W, KEY_E, KEY_A, KEY_S, KEY_D, KEY_Z,
                               KEY_C, KEY_FOUR, KEY_R, KEY_F, KEY_V};
 
-void init(chip_8 *c) {
-    memset(c->memory, 0, MEMORY_SIZE);
-    memset(c->display, 0, SCREEN_HEIGHT * SCREEN_WIDTH);
-    memset(c->stack, 0, STACK_SIZE);
-    memset(c->V, 0, 16);
-    memset(c->keycur, 0, 16);
-    memset(c->keyold, 0, 16);
-
-    memcpy(c->memory + FONT_ADDR, fontset, 80);
-    printf("[*] loaded font-set into memory\n");
-
-    c->pc = PRG_ADDR;
-    c->I = 0;
-    c->sp = 0;
-
-    c->delay_timer = 0;
-    c->sound_timer = 0;
-
-    c->running = false;
-
-    printf("[*] init finished!\n");
-}
-
-void step(chip_8 *c) {
-    uint8_t hi = c->memory[c->pc];
-    uint8_t lo = c->memory[c->pc + 1];
-    uint16_t full = (hi << 8) | lo;
-    c->pc += 2;
-    printf("0x%04x\n", full);
-    switch (hi >> 4) {
-        case 0x0:
-            if (0x00E0 == full) {
-                clear_display(c);
-            } else if (full == 0x00EE) {
-                printf("RETURN!");
-                return_subroutine(c);
-            } else {
-                fprintf(stderr, "[!] unimplemented opcode! 0x%04x\n", full);
-            }
-            break;
-        case 0x1:
-            jmp_addr(c, full & 0xfff);
-            break;
-        case 0x2:
-            call_subroutine(c, full & 0xfff);
-            break;
-        case 0x3:
-            skip_equal(c, hi & 0xf, lo);
-            break;
-        case 0x4:
-            skip_not_equal(c, hi & 0xf, lo);
-            break;
-        case 0x5:
-            skip_equal_reg(c, hi & 0xf, lo >> 4);
-            break;
-        case 0x6:
-            set_reg(c, hi & 0xf, lo);
-            break;
-        case 0x7:
-            add_reg(c, hi & 0xf, lo);
-            break;
-        case 0x8:
-            switch (lo & 0xf) {
-                case 0x0:
-                    set_reg_to_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x1:
-                    bit_or_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x2:
-                    bit_and_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x3:
-                    bit_xor_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x4:
-                    add_reg_to_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x5:
-                    sub_reg(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x6:
-                    shift_reg_right(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0x7:
-                    sub_reg_rev(c, hi & 0xf, lo >> 4);
-                    break;
-                case 0xe:
-                    shift_reg_left(c, hi & 0xf, lo >> 4);
-                    break;
-                default:
-                    fprintf(stderr, "[!] unimplemented opcode! 0x%04x\n", full);
-            }
-            break;
-        case 0x9:
-            skip_not_equal_reg(c, hi & 0xf, lo >> 4);
-            break;
-        case 0xa:
-            set_index_reg(c, full & 0xfff);
-            break;
-        case 0xb:
-            jmp_addr_V0(c, full & 0xfff);
-            break;
-        case 0xc:
-            num_gen(c, hi & 0xf, lo);
-            break;
-        case 0xd:
-            draw_sprite(c, hi & 0xf, lo >> 4, lo & 0xf);
-            break;
-        case 0xe:
-            switch (lo) {
-                case 0x9e:
-                    skip_if_key_pressed(c, hi & 0xf);
-                    break;
-                case 0xa1:
-                    skip_if_key_not_pressed(c, hi & 0xf);
-                    break;
-                default:
-                    fprintf(stderr, "[!] unimplemented opcode! 0x%04x\n", full);
-            }
-            break;
-        case 0xf:
-            switch (lo) {
-                case 0x07:
-                    set_reg_timer(c, hi & 0xf);
-                    break;
-                case 0x0a:
-                    wait_for_key(c, hi & 0xf);
-                    break;
-                case 0x15:
-                    set_delay_timer(c, hi & 0xf);
-                    break;
-                case 0x18:
-                    set_sound_timer(c, hi & 0xf);
-                    break;
-                case 0x1e:
-                    add_reg_index(c, hi & 0xf);
-                    break;
-                case 0x29:
-                    get_font_char(c, hi & 0xf);
-                    break;
-                case 0x33:
-                    bcd(c, hi & 0xf);
-                    break;
-                case 0x55:
-                    store_reg(c, hi & 0xf);
-                    break;
-                case 0x65:
-                    load_reg(c, hi & 0xf);
-                    break;
-                default:
-                    fprintf(stderr, "[!] unimplemented opcode! 0x%04x\n", full);
-            }
-            break;
-        default:
-            fprintf(stderr, "[!] unimplemented opcode! 0x%04x\n", full);
+// reset the machine and start a ROM. quirks and speed come from the library when it
+// knows the ROM, otherwise from what `orca-headless detect` recorded, otherwise defaults.
+// with skip_boot it starts at the ROM's first keypad read, from the boot cache if it can.
+static bool start_rom(chip_8 *c, const char *rom_path, const library *lib, int *steps_per_frame, bool skip_boot) {
+    init(c);
+    if (!load(c, rom_path)) return false;
+    *steps_per_frame = STEPS_PER_FRAME;
+    uint8_t digest[SHA1_SIZE];
+    bool have_digest = rom_sha1_file(rom_path, digest);
+    if (have_digest) {
+        const library_entry *e = library_find(lib, digest);
+        char hex[SHA1_HEX_SIZE];
+        quirk_profile profile;
+        sha1_hex(digest, hex);
+        if (e) {
+            c->profile = e->profile;
+            *steps_per_frame = e->ips / 60;
+        } else if (quirkdb_lookup(DETECT_DB, hex, &profile)) {
+            c->profile = profile;
+        }
     }
+    printf("[*] using the %s profile at %d instructions per frame\n", profile_name(c->profile), *steps_per_frame);
+    c->running = true;
+    if (skip_boot && have_digest) {
+        bool cached;
+        long frames = boot_skip(c, digest, *steps_per_frame, BOOT_CACHE_DIR, &cached);
+        if (frames) printf("[*] skipped %ld boot frames%s\n", frames, cached ? " from the cache" : "");
+    }
+    return true;
 }
 
-void load(chip_8 *c, char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        fprintf(stderr, "[!] failed to open the selected file!\n");
-        exit(1);
-    }
-    fseek(fp, 0L, SEEK_END);
-    long size = ftell(fp);
-    rewind(fp);
-    if (size > MEMORY_SIZE - PRG_ADDR) {
-        fprintf(stderr, "[!] file is too large to be copied\n");
-        exit(1);
-    }
-    fread(c->memory + PRG_ADDR, 1, size, fp);
-    fread(c->program, 1, size, fp);
-    // c8.program isn't empty
-    printf("[*] loaded ROM\n");
-    fclose(fp);
+// hand the movie's current machine back to normal play
+static void end_movie(tas_movie *t, chip_8 *c, rewind_log *history) {
+    *c = t->now;
+    rewind_reset(history, c);
+    tas_free(t);
 }
-int main() {
+
+int main(int argc, char **argv) {
     printf("[*] warming up...\n");
 
     chip_8 c8;
     init(&c8);
+    // orca --netplay <player 1|2> <port> <peer host[:port]>: the ROM loaded next is
+    // played against the peer, each side on its half of the keypad
+    static netplay net;
+    bool net_on = false;
+    if (argc == 5 && !strcmp(argv[1], "--netplay")) {
+        net_on = netplay_open(&net, (int) strtol(argv[2], NULL, 10) - 1, (uint16_t) strtol(argv[3], NULL, 10), argv[4]);
+        if (!net_on) return 1;
+    }
 
     InitWindow(WIN_WIDTH, WIN_HEIGHT, "orca");
     SetTargetFPS(60);
     bool rom_loaded = false;
+    char rom_path[4096] = {0};
     bool tweak_win = false;
+    bool debug_win = false;
+    bool library_win = false;
+    bool tas_win = false;
+    int steps_per_frame = STEPS_PER_FRAME;
+    bool boot_cache = false;
+    static run_ahead ahead;
+    static debugger dbg;
+    static debug_view dbg_view;
+    static cfg flow;
+    static rewind_log history;
+    static tas_movie movie;
+    static tas_view movie_view;
+    // keys reach the machine as events at the instruction they fall on
+    static input_queue input;
+    uint32_t input_frame = 0;
+    FILE *input_log = NULL;
+    uint32_t input_log_start = 0;
+    debug_reset(&dbg);
+    debug_view_init(&dbg_view);
+    dbg_view.flow = &flow;
+    rewind_init(&history, REWIND_BUDGET);
+    // a single mmap however many ROMs it lists; without one the browser says how to make it
+    static library lib;
+    static library_view lib_view;
+    library_open(&lib, LIBRARY_CATALOGUE);
+    library_view_init(&lib_view, &lib);
+    static perf_ring perf;
+    trace_set_thread_name("main");
     while (!WindowShouldClose()) {
+        // F9 toggles a chrome trace capture, written out when it stops. it flips outside
+        // the frame zone so every capture holds whole frames.
+        if (IsKeyPressed(KEY_F9)) {
+            if (trace_enabled) {
+                trace_stop();
+                trace_dump("orca_trace.json");
+            } else {
+                trace_start();
+            }
+        }
+        TRACE_BEGIN("frame");
+        double frame_start = perf_now();
+        perf_sample sample = {0};
+        // F8 toggles starting ROMs past their input-free boot sequence
+        if (IsKeyPressed(KEY_F8)) {
+            boot_cache = !boot_cache;
+            printf("[*] boot cache %s\n", boot_cache ? "on" : "off");
+        }
+        // F7 cycles run-ahead through 0..RUN_AHEAD_MAX frames
+        if (IsKeyPressed(KEY_F7)) {
+            ahead.frames = (ahead.frames + 1) % (RUN_AHEAD_MAX + 1);
+            printf("[*] run-ahead %d frames\n", ahead.frames);
+        }
+        // F6 restarts the ROM and records its key events, after the profile and speed
+        // they need, until pressed again. `orca-headless run --input` replays them.
+        if (IsKeyPressed(KEY_F6) && rom_loaded && !net_on && !tas_win) {
+            if (input_log) {
+                fclose(input_log);
+                input_log = NULL;
+                printf("[*] input written to orca_input.txt\n");
+            } else if ((input_log = fopen("orca_input.txt", "w"))) {
+                start_rom(&c8, rom_path, &lib, &steps_per_frame, false);
+                input_write_header(input_log, (input_header) {c8.profile, steps_per_frame});
+                rewind_reset(&history, &c8);
+                cfg_build(&flow, &c8);
+                input_log_start = input_frame;
+                printf("[*] recording input\n");
+            } else {
+                fprintf(stderr, "[!] failed to open orca_input.txt\n");
+            }
+        }
+        // the skipped frames never reach the debugger, so armed breakpoints always boot live
+        bool skip_boot = boot_cache && !dbg.armed && !net_on;
         BeginDrawing();
+        TRACE_BEGIN("gui");
         GuiPanel((Rectangle) {0, 0, WIN_WIDTH, GUI_HEIGHT}, NULL);
 
-        // load rom button
+        // rom library button, usable before anything is loaded
+        GuiEnable();
         if (GuiButton((Rectangle) {0, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_FOLDER_FILE_OPEN, NULL))) {
-            printf("OPEN ROM");
+            library_win = !library_win;
         }
+        if (!rom_loaded) GuiDisable();
 
         // save / load state button
         if (GuiButton((Rectangle) {GUI_HEIGHT, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_FILE_SAVE_CLASSIC, NULL))) {
             printf("SAVE / LOAD STATE");
         }
 
+        // input movie button; the movie starts from the machine as it is now
+        if (GuiButton((Rectangle) {GUI_HEIGHT * 2, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_FILETYPE_VIDEO, NULL)) && !net_on) {
+            if (tas_win) {
+                end_movie(&movie, &c8, &history);
+                tas_win = false;
+            } else {
+                tas_win = tas_init(&movie, &c8, steps_per_frame, TAS_BUDGET);
+                movie_view = (tas_view) {0};
+            }
+        }
+
         // OPERATION BUTTONS
 
-        // play/pause button
+        // play/pause button; a trapped machine only resumes after a reverse step or restart
         if (GuiButton((Rectangle) {WIN_WIDTH / 2 - GUI_HEIGHT * 1.5f, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(c8.running ? ICON_PLAYER_PAUSE : ICON_PLAYER_PLAY, NULL))) {
-            c8.running = !c8.running;
+            c8.running = !c8.running && c8.trap == TRAP_NONE;
+        }
+
+        // reverse step button
+        if (GuiButton((Rectangle) {WIN_WIDTH / 2 - GUI_HEIGHT * 2.5f, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_UNDO, NULL))) {
+            c8.running = false;
+            rewind_step_back(&history, &c8);
         }
 
         // step into button
-        if (GuiButton((Rectangle) {WIN_WIDTH / 2 - GUI_HEIGHT / 2, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_STEP_INTO, NULL))) {
+        if (GuiButton((Rectangle) {WIN_WIDTH / 2 - GUI_HEIGHT / 2, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_STEP_INTO, NULL)) && c8.trap == TRAP_NONE) {
             step(&c8);
+            rewind_add_steps(&history, &c8, 1);
         }
 
         // restart
         if (GuiButton((Rectangle) {WIN_WIDTH / 2 + GUI_HEIGHT / 2, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_RESTART, NULL))) {
-            init(&c8);
-            memcpy(c8.program, c8.memory + PRG_ADDR, MEMORY_SIZE - PRG_ADDR);
-            c8.running = true;
-            // c8.program is empty
+            if (tas_win) {
+                tas_free(&movie);
+                tas_win = false;
+            }
+            start_rom(&c8, rom_path, &lib, &steps_per_frame, skip_boot);
+            rewind_reset(&history, &c8);
+            cfg_build(&flow, &c8);
+            if (net_on) netplay_start(&net, &c8, steps_per_frame);
+        }
+
+        if (GuiButton((Rectangle) {WIN_WIDTH - GUI_HEIGHT * 3, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_DEMON, NULL))) {
+            debug_win = !debug_win;
         }
 
         if (GuiButton((Rectangle) {WIN_WIDTH - GUI_HEIGHT * 2, 0, GUI_HEIGHT, GUI_HEIGHT}, GuiIconText(ICON_EYE_ON, NULL))) {
@@ -255,10 +241,14 @@ int main() {
         if (IsFileDropped() && !rom_loaded) {
             FilePathList dropped_files = LoadDroppedFiles();
             if (dropped_files.count == 1) {
-                load(&c8, dropped_files.paths[0]);
-                GuiEnable();
-                rom_loaded = true;
-                c8.running = true;
+                strncpy(rom_path, dropped_files.paths[0], sizeof(rom_path) - 1);
+                if (start_rom(&c8, rom_path, &lib, &steps_per_frame, skip_boot)) {
+                    rewind_reset(&history, &c8);
+                    cfg_build(&flow, &c8);
+                    if (net_on) netplay_start(&net, &c8, steps_per_frame);
+                    GuiEnable();
+                    rom_loaded = true;
+                }
             }
             UnloadDroppedFiles(dropped_files);
         }
@@ -269,24 +259,166 @@ int main() {
             DrawText(text, WIN_WIDTH / 2 - MeasureText(text, font_size) / 2, WIN_HEIGHT / 2 - font_size / 2, font_size,
                      WHITE);
         }
-        if (c8.running) {
-            if (c8.delay_timer > 0) c8.delay_timer--;
+        TRACE_END("gui");
+        const chip_8 *shown = &c8;
+        if (net_on && rom_loaded) {
+            // the session owns the machine: no pausing, rewind or breakpoints mid-game
+            uint16_t keys = 0;
             for (uint8_t k = 0; k < 16; k++) {
-                c8.keyold[k] = c8.keycur[k];
-                c8.keycur[k] = IsKeyDown(keyMapping[k]);
+                keys |= IsKeyDown(keyMapping[k]) << k;
+            }
+            TRACE_ZONE("netplay") {
+                netplay_frame(&net, keys);
+            }
+            c8 = net.live;
+        } else if (tas_win) {
+            // the movie owns the machine: it only moves by playing or seeking
+            if (movie_view.playing) {
+                if (movie_view.recording) {
+                    uint16_t keys = 0;
+                    for (uint8_t k = 0; k < 16; k++) {
+                        keys |= IsKeyDown(keyMapping[k]) << k;
+                    }
+                    tas_set_keys(&movie, movie.cursor, keys);
+                }
+                TRACE_ZONE("tas") {
+                    tas_seek(&movie, movie.cursor + 1);
+                }
+                if (movie.now.trap != TRAP_NONE) movie_view.playing = false;
             }
-            for (int a = 0; a <= 8 && c8.running; a++) {
-                step(&c8);
+            c8 = movie.now;
+        } else if (c8.running) {
+            uint16_t keys = 0;
+            TRACE_ZONE("input") {
+                // raylib samples the keyboard once a frame, so a key pressed and released
+                // between two samples is only in the pressed queue. it is held for the
+                // first half of the frame, long enough for FX0A to see it go down and up.
+                uint16_t tapped = 0;
+                for (int key = GetKeyPressed(); key; key = GetKeyPressed()) {
+                    for (uint8_t k = 0; k < 16; k++) {
+                        if (key == (int) keyMapping[k]) tapped |= 1 << k;
+                    }
+                }
+                for (uint8_t k = 0; k < 16; k++) {
+                    keys |= IsKeyDown(keyMapping[k]) << k;
+                }
+                tapped &= ~keys;
+                key_event events[2] = {{input_frame, 0, keys | tapped}, {input_frame, steps_per_frame / 2, keys}};
+                int count = tapped ? 2 : (keys != c8.keycur);
+                for (int i = 0; i < count; i++) {
+                    input_push(&input, events[i]);
+                    if (input_log) {
+                        events[i].frame -= input_log_start;
+                        input_write(input_log, events[i]);
+                    }
+                }
             }
+            TRACE_BEGIN("step");
+            double step_start = perf_now();
+            sample.steps = input_run_frame(&c8, &input, input_frame++, steps_per_frame, &dbg, &sample.idle, &history);
+            TRACE_ZONE("run_ahead") {
+                shown = run_ahead_frame(&ahead, &c8, keys, steps_per_frame);
+            }
+            sample.step_ms = (float) ((perf_now() - step_start) * 1000.0);
+            TRACE_END("step");
+        }
+        TRACE_BEGIN("draw_sprite_ray");
+        double render_start = perf_now();
+        draw_sprite_ray(shown);
+        sample.render_ms = (float) ((perf_now() - render_start) * 1000.0);
+        TRACE_END("draw_sprite_ray");
+        if (c8.trap != TRAP_NONE) {
+            const char *trap_text = TextFormat("%s at %03X", trap_name(c8.trap), c8.trap_pc);
+            DrawText(trap_text, WIN_WIDTH / 2 - MeasureText(trap_text, font_size) / 2, WIN_HEIGHT / 2 - font_size / 2,
+                     font_size, RED);
         }
-        draw_sprite_ray(&c8);
         if (tweak_win) {
-            if (GuiWindowBox((Rectangle){0, 0 + GUI_HEIGHT - 1, (SCREEN_WIDTH * GFX_SCALE) / 2, SCREEN_HEIGHT * GFX_SCALE}, "viewing tweaks")) {
+            TRACE_BEGIN("hud");
+            Rectangle tweak_bounds = {0, 0 + GUI_HEIGHT - 1, (SCREEN_WIDTH * GFX_SCALE) / 2, SCREEN_HEIGHT * GFX_SCALE};
+            if (GuiWindowBox(tweak_bounds, "viewing tweaks")) {
                 tweak_win = !tweak_win;
             }
+            perf_stats stats;
+            perf_summarize(&perf, &stats);
+            tweak_bounds.y += 24;
+            tweak_bounds.height -= 24;
+            draw_perf_hud(&stats, tweak_bounds, sizeof(c8) + sizeof(perf) + rewind_memory(&history));
+            TRACE_END("hud");
+        }
+        if (debug_win) {
+            Rectangle debug_bounds = {WIN_WIDTH / 2, GUI_HEIGHT - 1, WIN_WIDTH / 2, SCREEN_HEIGHT * GFX_SCALE};
+            if (GuiWindowBox(debug_bounds, "debugger")) {
+                debug_win = !debug_win;
+            }
+            switch (draw_debug_view(&dbg_view, &c8, &dbg, debug_bounds)) {
+                case DEBUG_ACTION_REVERSE_CONTINUE:
+                    c8.running = false;
+                    if (!rewind_continue_back(&history, &c8, &dbg)) {
+                        snprintf(dbg_view.message, sizeof(dbg_view.message), "no earlier stop in history");
+                    }
+                    break;
+                case DEBUG_ACTION_LAST_WRITE: {
+                    uint64_t cycle;
+                    uint16_t pc;
+                    if (rewind_last_write(&history, &c8, dbg_view.query_start, dbg_view.query_end, &cycle, &pc)) {
+                        snprintf(dbg_view.message, sizeof(dbg_view.message), "%03X-%03X last written by %03X, %llu ago",
+                                 dbg_view.query_start, dbg_view.query_end - 1, pc,
+                                 (unsigned long long) (c8.cycles - cycle));
+                    } else {
+                        snprintf(dbg_view.message, sizeof(dbg_view.message), "%03X-%03X not written in history",
+                                 dbg_view.query_start, dbg_view.query_end - 1);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        if (tas_win) {
+            Rectangle tas_bounds = {WIN_WIDTH / 2, GUI_HEIGHT - 1, WIN_WIDTH / 2, SCREEN_HEIGHT * GFX_SCALE};
+            if (GuiWindowBox(tas_bounds, "input movie")) {
+                end_movie(&movie, &c8, &history);
+                tas_win = false;
+            } else {
+                draw_tas_view(&movie_view, &movie, tas_bounds);
+            }
+        }
+        if (library_win) {
+            GuiEnable();
+            Rectangle library_bounds = {0, GUI_HEIGHT - 1, WIN_WIDTH / 2, SCREEN_HEIGHT * GFX_SCALE};
+            if (GuiWindowBox(library_bounds, "library")) {
+                library_win = !library_win;
+            }
+            const library_entry *picked = draw_library_view(&lib_view, library_bounds);
+            if (picked) {
+                strncpy(rom_path, picked->path, sizeof(rom_path) - 1);
+                if (tas_win) {
+                    tas_free(&movie);
+                    tas_win = false;
+                }
+                if (start_rom(&c8, rom_path, &lib, &steps_per_frame, skip_boot)) {
+                    rewind_reset(&history, &c8);
+                    cfg_build(&flow, &c8);
+                    if (net_on) netplay_start(&net, &c8, steps_per_frame);
+                    rom_loaded = true;
+                    library_win = false;
+                }
+            }
+            if (!rom_loaded) GuiDisable();
+        }
+        // present also polls input and waits out the frame
+        TRACE_ZONE("present") {
+            EndDrawing();
         }
-        EndDrawing();
+        sample.frame_ms = (float) ((perf_now() - frame_start) * 1000.0);
+        perf_push(&perf, &sample);
+        TRACE_END("frame");
     }
+    library_view_free(&lib_view);
+    library_close(&lib);
+    if (net_on) netplay_close(&net);
+    if (tas_win) tas_free(&movie);
+    if (input_log) fclose(input_log);
     CloseWindow();
     return 0;
 }
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netplay.h>
+#include <cpu.h>
+#include <perf.h>
+#include <statehash.h>
+
+// rollback netplay over UDP. every packet carries all the local inputs the peer hasn't
+// acknowledged yet, so a lost packet costs nothing but a later correction, and there
+// is no handshake: each side just starts sending once its ROM is loaded.
+
+static const char packet_magic[4] = "ONP1";
+
+#define PACKET_HEADER 30
+#define PACKET_INPUTS (NET_HISTORY / 2)
+
+uint16_t netplay_mask(int player) {
+    return player ? NET_KEYS_P2 : NET_KEYS_P1;
+}
+
+// peer is "host" or "host:port"
+bool netplay_open(netplay *n, int player, uint16_t port, const char *peer) {
+    memset(n, 0, sizeof(*n));
+    n->sock = -1;
+    n->player = player ? 1 : 0;
+    n->desync_frame = -1;
+    n->loss_rng = 1;
+
+    char host[256], service[8];
+    snprintf(host, sizeof(host), "%s", peer);
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        snprintf(service, sizeof(service), "%s", colon + 1);
+        *colon = 0;
+    } else {
+        snprintf(service, sizeof(service), "%d", NET_PORT);
+    }
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM}, *found;
+    if (getaddrinfo(host, service, &hints, &found) != 0) {
+        fprintf(stderr, "[!] can't resolve %s\n", peer);
+        return false;
+    }
+    memcpy(&n->peer, found->ai_addr, sizeof(n->peer));
+    freeaddrinfo(found);
+
+    n->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in local = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (n->sock < 0 || bind(n->sock, (struct sockaddr *) &local, sizeof(local)) != 0) {
+        fprintf(stderr, "[!] can't listen on UDP port %u\n", port);
+        netplay_close(n);
+        return false;
+    }
+    printf("[*] player %d on port %u, peer %s\n", n->player + 1, port, peer);
+    return true;
+}
+
+void netplay_close(netplay *n) {
+    if (n->sock >= 0) close(n->sock);
+    n->sock = -1;
+}
+
+// both sides start from the same machine at the same time; its hash doubles as the
+// session tag. starting again (restart, another ROM) begins a new session at frame 0.
+void netplay_start(netplay *n, const chip_8 *boot, int steps_per_frame) {
+    n->frame = n->confirmed = n->remote_count = n->peer_ack = 0;
+    n->last_hash_sent = 0;
+    memset(n->hash_frames, 0, sizeof(n->hash_frames));
+    n->desync_frame = -1;
+    n->bad_peer = false;
+    n->steps_per_frame = steps_per_frame;
+    n->sync = *boot;
+    n->live = *boot;
+    uint64_t h = machine_hash(boot);
+    n->tag = (uint32_t) (h ^ (h >> 32)) ^ (uint32_t) steps_per_frame;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = v >> (8 * i);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static void put64(uint8_t *p, uint64_t v) {
+    put32(p, (uint32_t) v);
+    put32(p + 4, (uint32_t) (v >> 32));
+}
+
+static uint64_t get64(const uint8_t *p) {
+    return get32(p) | (uint64_t) get32(p + 4) << 32;
+}
+
+static void check_hashes(netplay *n, int slot) {
+    if (n->hash_frames[0][slot] && n->hash_frames[0][slot] == n->hash_frames[1][slot] &&
+        n->hashes[0][slot] != n->hashes[1][slot] && n->desync_frame < 0) {
+        n->desync_frame = n->hash_frames[0][slot];
+        fprintf(stderr, "[!] desync: the machines differ at frame %ld\n", n->desync_frame);
+    }
+}
+
+static void record_hash(netplay *n, int side, uint32_t frame, uint64_t hash) {
+    int slot = (int) (frame / NET_HASH_INTERVAL % NET_HASHES);
+    n->hash_frames[side][slot] = frame;
+    n->hashes[side][slot] = hash;
+    if (side == 0) n->last_hash_sent = frame;
+    check_hashes(n, slot);
+}
+
+static void send_inputs(netplay *n) {
+    uint8_t packet[PACKET_HEADER + PACKET_INPUTS * 2];
+    uint32_t first = n->peer_ack;
+    uint32_t count = n->frame - first < PACKET_INPUTS ? n->frame - first : PACKET_INPUTS;
+    int slot = (int) (n->last_hash_sent / NET_HASH_INTERVAL % NET_HASHES);
+    memcpy(packet, packet_magic, 4);
+    put32(packet + 4, n->tag);
+    put32(packet + 8, first);
+    packet[12] = count;
+    packet[13] = 0;
+    put32(packet + 14, n->remote_count);
+    put32(packet + 18, n->last_hash_sent);
+    put64(packet + 22, n->last_hash_sent ? n->hashes[0][slot] : 0);
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t keys = n->local[(first + i) % NET_HISTORY];
+        packet[PACKET_HEADER + 2 * i] = keys;
+        packet[PACKET_HEADER + 2 * i + 1] = keys >> 8;
+    }
+    if (n->loss_percent) {
+        n->loss_rng = n->loss_rng * 1103515245 + 12345;
+        if ((n->loss_rng >> 16) % 100 < n->loss_percent) return;
+    }
+    if (sendto(n->sock, packet, PACKET_HEADER + 2 * count, 0, (struct sockaddr *) &n->peer, sizeof(n->peer)) > 0) {
+        n->sent++;
+    }
+}
+
+static void take_packet(netplay *n, const uint8_t *packet, long size) {
+    if (size < PACKET_HEADER || memcmp(packet, packet_magic, 4)) return;
+    if (get32(packet + 4) != n->tag) {
+        if (!n->bad_peer) fprintf(stderr, "[!] the peer is running a different ROM or speed\n");
+        n->bad_peer = true;
+        return;
+    }
+    uint32_t first = get32(packet + 8), count = packet[12];
+    uint32_t ack = get32(packet + 14), hash_frame = get32(packet + 18);
+    if (size < PACKET_HEADER + 2 * (long) count) return;
+    n->received++;
+    if (ack > n->peer_ack && ack <= n->frame) n->peer_ack = ack;
+    if (hash_frame) record_hash(n, 1, hash_frame, get64(packet + 22));
+    // inputs arrive as a contiguous run starting at or before the first one we lack
+    for (uint32_t f = n->remote_count; f < first + count && f >= first; f++) {
+        if (f - n->confirmed >= NET_HISTORY) break;
+        const uint8_t *p = packet + PACKET_HEADER + 2 * (f - first);
+        n->remote[f % NET_HISTORY] = p[0] | p[1] << 8;
+        n->remote_count = f + 1;
+    }
+}
+
+static void receive(netplay *n) {
+    uint8_t packet[PACKET_HEADER + PACKET_INPUTS * 2];
+    struct sockaddr_in from;
+    socklen_t from_size = sizeof(from);
+    long size;
+    while ((size = recvfrom(n->sock, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr *) &from,
+                            &from_size)) >= 0) {
+        if (from.sin_addr.s_addr == n->peer.sin_addr.s_addr && from.sin_port == n->peer.sin_port) {
+            take_packet(n, packet, size);
+        }
+        from_size = sizeof(from);
+    }
+}
+
+static void simulate(const netplay *n, chip_8 *c, uint32_t frame, uint16_t remote) {
+    uint16_t local = n->local[frame % NET_HISTORY];
+    begin_frame(c, (local & netplay_mask(n->player)) | (remote & netplay_mask(!n->player)));
+    schedule_steps(c, n->steps_per_frame);
+}
+
+// the peer keeps holding whatever it held last
+static uint16_t predict(const netplay *n, uint32_t frame) {
+    if (frame < n->remote_count) return n->remote[frame % NET_HISTORY];
+    return n->remote_count ? n->remote[(n->remote_count - 1) % NET_HISTORY] : 0;
+}
+
+// move `sync` through every frame that now has both inputs, and if any of them had
+// been guessed wrong, rebuild `live` from it
+static void confirm(netplay *n) {
+    uint32_t known = n->remote_count < n->frame ? n->remote_count : n->frame;
+    if (known <= n->confirmed) return;
+    double start = perf_now();
+    long wrong = -1;
+    for (uint32_t f = n->confirmed; f < known; f++) {
+        uint16_t remote = n->remote[f % NET_HISTORY];
+        if (wrong < 0 && ((remote ^ n->predicted[f % NET_HISTORY]) & netplay_mask(!n->player))) wrong = f;
+        simulate(n, &n->sync, f, remote);
+        if ((f + 1) % NET_HASH_INTERVAL == 0) record_hash(n, 0, f + 1, machine_hash(&n->sync));
+    }
+    n->confirmed = known;
+    if (wrong < 0) return;
+
+    n->live = n->sync;
+    for (uint32_t f = n->confirmed; f < n->frame; f++) {
+        n->predicted[f % NET_HISTORY] = predict(n, f);
+        simulate(n, &n->live, f, n->predicted[f % NET_HISTORY]);
+    }
+    uint32_t depth = n->frame - (uint32_t) wrong;
+    double ms = (perf_now() - start) * 1000.0;
+    n->rollbacks++;
+    n->rollback_frames += depth;
+    if (depth > n->max_rollback) n->max_rollback = depth;
+    if (ms > n->max_resim_ms) n->max_resim_ms = ms;
+}
+
+// receive and resend without simulating anything new
+void netplay_poll(netplay *n) {
+    receive(n);
+    confirm(n);
+    send_inputs(n);
+}
+
+// one 60 Hz frame with the local player's keys. returns false if `live` couldn't
+// advance because the peer is too far behind.
+bool netplay_frame(netplay *n, uint16_t keys) {
+    receive(n);
+    confirm(n);
+    bool advanced = n->frame - n->confirmed < NET_WINDOW && n->frame - n->peer_ack < PACKET_INPUTS;
+    if (advanced) {
+        uint32_t f = n->frame;
+        n->local[f % NET_HISTORY] = keys & netplay_mask(n->player);
+        n->predicted[f % NET_HISTORY] = predict(n, f);
+        simulate(n, &n->live, f, n->predicted[f % NET_HISTORY]);
+        n->frame++;
+        confirm(n);
+    } else {
+        n->stalls++;
+    }
+    send_inputs(n);
+    return advanced;
+}
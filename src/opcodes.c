@@ -3,25 +3,25 @@
 #include <stdlib.h>
 #include <main.h>
 #include <opcodes.h>
+#include <cpu.h>
+#include <statehash.h>
 #include <stdbool.h>
-#include <raylib.h>
 #include <unistd.h>
 
 // 00E0: clear display
 // the title says it all; clears chip-8's display.
 void clear_display(chip_8 *c) {
     memset(c->display, 0, 64 * 32);
+    c->display_hash = 0;
 }
 
 // 00EE: return from subroutine
 // pop the last address from stack and set the PC to it
 void return_subroutine(chip_8 *c) {
-    //c->pc = pop(c);
     if (c->sp > 0) {
         c->pc = c->stack[--c->sp];
     } else {
-        fprintf(stderr, "stack underflow!!!\n");
-        exit(1);
+        raise_trap(c, TRAP_STACK_UNDERFLOW);
     }
 }
 
@@ -41,7 +41,7 @@ void jmp_addr(chip_8 *c, uint16_t addr) {
 // (from: https://tobiasvl.github.io/blog/write-a-chip-8-emulator/#00ee-and-2nnn-subroutines)
 void call_subroutine(chip_8 *c, uint16_t addr) {
     if (c->sp >= STACK_SIZE) {
-        c->pc -= 2;
+        raise_trap(c, TRAP_STACK_OVERFLOW);
     } else {
         c->stack[c->sp++] = c->pc;
         c->pc = addr;
@@ -87,21 +87,19 @@ void set_reg_to_reg(chip_8 *c, uint8_t vx, uint8_t vy) {
 }
 
 // 8XY1: Vx is set to bitwise OR of Vy
+// (the VIP's VF reset for 8XY1-8XY3 is a quirk, applied by the dispatcher in cpu.c)
 void bit_or_reg(chip_8 *c, uint8_t vx, uint8_t vy) {
     c->V[vx] |= c->V[vy];
-    c->V[0xf] = 0;
 }
 
 // 8XY2: Vx is set to bitwise AND of Vy
 void bit_and_reg(chip_8 *c, uint8_t vx, uint8_t vy) {
     c->V[vx] &= c->V[vy];
-    c->V[0xf] = 0;
 }
 
 // 8XY3: Vx is set to bitwise XOR of Vy
 void bit_xor_reg(chip_8 *c, uint8_t vx, uint8_t vy) {
     c->V[vx] ^= c->V[vy];
-    c->V[0xf] = 0;
 }
 
 // 8XY4: set Vx to Vx + Vy
@@ -129,8 +127,8 @@ void sub_reg(chip_8 *c, uint8_t vx, uint8_t vy) {
 }
 
 // 8XY6: shift Vx one bit to right
-void shift_reg_right(chip_8 *c, uint8_t vx, uint8_t vy) {
-    c->V[vx] = c->V[vy];
+// the VIP copies Vy into Vx first; that's a quirk, applied by the dispatcher in cpu.c
+void shift_reg_right(chip_8 *c, uint8_t vx) {
     uint8_t bit = (c->V[vx]) & 1;
     c->V[vx] >>= 1;
     c->V[0xf] = bit;
@@ -149,10 +147,10 @@ void sub_reg_rev(chip_8 *c, uint8_t vx, uint8_t vy) {
 }
 
 // 8XYE: shift Vx one bit to left
-void shift_reg_left(chip_8 *c, uint8_t vx, uint8_t vy) {
-    c->V[vx] = c->V[vy];
+void shift_reg_left(chip_8 *c, uint8_t vx) {
+    uint8_t bit = (c->V[vx] >> 7) & 1;
     c->V[vx] <<= 1;
-    c->V[0xF] = (c->V[vx] >> 7) & 1;
+    c->V[0xF] = bit;
 }
 
 // 9XY0: skip if Vx is NOT equal to Vy
@@ -169,15 +167,21 @@ void set_index_reg(chip_8 *c, uint16_t value) {
 }
 
 // BNNN: jump to address plus V0
-void jmp_addr_V0(chip_8 *c, uint16_t addr) {
-    c->pc = addr + c->V[0];
+// (SCHIP reads it as BXNN and adds Vx instead; the dispatcher picks the register)
+void jmp_addr_reg(chip_8 *c, uint16_t addr, uint8_t reg) {
+    c->pc = addr + c->V[reg];
 }
 
 // CXNN: generate a random number
 // generate a random number (probably 0 to 255), binary AND it with nn and set Vx to it.
+// the generator (xorshift32) lives in the machine state, so replaying from a snapshot gives the same numbers.
 void num_gen(chip_8 *c, uint8_t vx, uint16_t value) {
-    int rand_int = rand() % 256;
-    c->V[vx] = rand_int & value;
+    uint32_t x = c->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c->rng = x;
+    c->V[vx] = (x >> 24) & value;
 }
 
 // DXYN: draw sprite
@@ -187,6 +191,10 @@ void num_gen(chip_8 *c, uint8_t vx, uint16_t value) {
 // (from: https://tobiasvl.github.io/blog/write-a-chip-8-emulator/)
 void draw_sprite(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
     int width = 8;
+    if (c->I + n > MEMORY_SIZE) {
+        raise_trap(c, TRAP_BAD_ADDRESS);
+        return;
+    }
     c->V[0xF] = 0;
     int x_pos = (c->V[vx] & 0x3F);
     int y_pos = (c->V[vy] & 0x1F);
@@ -209,6 +217,7 @@ void draw_sprite(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
                     c->V[0xF] = 1;
                 }
                 c->display[x][y] ^= 1;
+                c->display_hash ^= zobrist_pixels[x][y];
             }
             // Point spriteData to the next bit
             spriteData <<= 1;
@@ -216,16 +225,70 @@ void draw_sprite(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
     }
 }
 
+// DXYN with XO-CHIP wrapping: pixels that fall off one edge come back on the other
+void draw_sprite_wrap(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
+    if (c->I + n > MEMORY_SIZE) {
+        raise_trap(c, TRAP_BAD_ADDRESS);
+        return;
+    }
+    c->V[0xF] = 0;
+    for (int row = 0; row < n; row++) {
+        uint8_t spriteData = c->memory[c->I + row];
+        int y = (c->V[vy] + row) % 32;
+        for (int col = 0; col < 8; col++) {
+            if (spriteData & (0x80 >> col)) {
+                int x = (c->V[vx] + col) % 64;
+                if (c->display[x][y] == 1) {
+                    c->V[0xF] = 1;
+                }
+                c->display[x][y] ^= 1;
+                c->display_hash ^= zobrist_pixels[x][y];
+            }
+        }
+    }
+}
+
+// DXYN with VF dead, as above: the same pixels flipped, without testing each for a
+// collision. X and Y are never VF here.
+void draw_sprite_xor(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
+    int x_pos = c->V[vx] & 0x3F;
+    int y_pos = c->V[vy] & 0x1F;
+    int width = x_pos + 8 > 64 ? 64 - x_pos : 8;
+    for (int row = 0; row < n && y_pos + row < 32; row++) {
+        uint8_t spriteData = c->memory[c->I + row];
+        for (int col = 0; col < width; col++) {
+            if (spriteData & (0x80 >> col)) {
+                c->display[x_pos + col][y_pos + row] ^= 1;
+                c->display_hash ^= zobrist_pixels[x_pos + col][y_pos + row];
+            }
+        }
+    }
+}
+
+void draw_sprite_wrap_xor(chip_8 *c, uint8_t vx, uint8_t vy, uint8_t n) {
+    for (int row = 0; row < n; row++) {
+        uint8_t spriteData = c->memory[c->I + row];
+        int y = (c->V[vy] + row) % 32;
+        for (int col = 0; col < 8; col++) {
+            if (spriteData & (0x80 >> col)) {
+                int x = (c->V[vx] + col) % 64;
+                c->display[x][y] ^= 1;
+                c->display_hash ^= zobrist_pixels[x][y];
+            }
+        }
+    }
+}
+
 // EXA1: skip next instruction if key, that's stored in Vx is pressed
 void skip_if_key_pressed(chip_8 *c, uint8_t vx) {
-    if (c->keycur[c->V[vx] & 0xF] == true) {
+    if (c->keycur >> (c->V[vx] & 0xF) & 1) {
         c->pc += 2;
     }
 }
 
 // EX9E: skip next instruction if key, that's stored in Vx is NOT pressed
 void skip_if_key_not_pressed(chip_8 *c, uint8_t vx) {
-    if (c->keycur[c->V[vx] & 0xF] == false) {
+    if (!(c->keycur >> (c->V[vx] & 0xF) & 1)) {
         c->pc += 2;
     }
 }
@@ -237,12 +300,13 @@ void set_reg_timer(chip_8 *c, uint8_t vx) {
 
 // FX0A: halt until key press and store in Vx, and wait for the key to be released
 void wait_for_key(chip_8 *c, uint8_t reg) {
-    for (uint8_t k = 0; k < 16; k++) {
-        if (c->keyold[k] & !c->keycur[k]) {
-            c->keyold[k] = false;
-            c->V[reg] = k;
-            return;
-        }
+    uint16_t released = c->keyold & ~c->keycur;
+    if (released) {
+        // the lowest released key wins
+        uint8_t k = __builtin_ctz(released);
+        c->keyold &= ~(1u << k);
+        c->V[reg] = k;
+        return;
     }
     c->pc -= 2;
 }
@@ -273,27 +337,44 @@ void get_font_char(chip_8 *c, uint8_t vx) {
 // for example, if Vx contains 156, (or 9C in hex), it would put the number 1 at the address in I,
 // 5 in address I + 1, and 6 un address I + 2
 void bcd(chip_8 *c, uint8_t vx) {
+    if (c->I + 3 > MEMORY_SIZE) {
+        raise_trap(c, TRAP_BAD_ADDRESS);
+        return;
+    }
     int num = c->V[vx];
     int ones = num % 10;
     int tens = (num / 10) % 10;
     int huns = (num / 100) % 10;
-    c->memory[c->I + 0] = huns & 0xff;
-    c->memory[c->I + 1] = tens & 0xff;
-    c->memory[c->I + 2] = ones & 0xff;
+    write_memory(c, c->I + 0, huns & 0xff);
+    write_memory(c, c->I + 1, tens & 0xff);
+    write_memory(c, c->I + 2, ones & 0xff);
 }
 
 // FX55: store register data in memory
+// (whether I is left pointing past the stored bytes is a quirk, see cpu.c)
 void store_reg(chip_8 *c, uint8_t x) {
+    if (c->I + x + 1 > MEMORY_SIZE) {
+        raise_trap(c, TRAP_BAD_ADDRESS);
+        return;
+    }
+    // hash the change first so the copy itself stays a memcpy
+    uint16_t addr = c->I;
+    uint64_t h = c->memory_hash;
     for (int i = 0; i <= x; i++) {
-        c->memory[c->I + i] = c->V[i];
+        h += zobrist_delta(addr + i, c->memory[addr + i], c->V[i]);
     }
-    c->I += x + 1;
+    c->memory_hash = h;
+    c->written |= 1u << (addr / MEMORY_PAGE) | 1u << ((addr + x) / MEMORY_PAGE);
+    memcpy(c->memory + addr, c->V, x + 1);
 }
 
 // FX65: load register data from memory
 void load_reg(chip_8 *c, uint8_t x) {
+    if (c->I + x + 1 > MEMORY_SIZE) {
+        raise_trap(c, TRAP_BAD_ADDRESS);
+        return;
+    }
     for (int i = 0; i <= x; i++) {
         c->V[i] = c->memory[c->I + i];
     }
-    c->I += x + 1;
 }
\ No newline at end of file
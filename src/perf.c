@@ -0,0 +1,54 @@
+#include <string.h>
+#include <time.h>
+#include <perf.h>
+
+// monotonic wall clock in seconds
+double perf_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// record one host frame; overwrites the oldest sample once the ring is full
+void perf_push(perf_ring *r, const perf_sample *s) {
+    r->samples[r->head] = *s;
+    r->head = (r->head + 1) & (PERF_SAMPLES - 1);
+    if (r->count < PERF_SAMPLES) r->count++;
+}
+
+static int hist_bucket(double ms) {
+    int b = (int) (ms * PERF_HIST_BUCKETS / PERF_HIST_MS);
+    if (b < 0) return 0;
+    if (b >= PERF_HIST_BUCKETS) return PERF_HIST_BUCKETS - 1;
+    return b;
+}
+
+// fold the ring into averages and histograms. only called while the HUD is open,
+// so the main loop itself never pays more than perf_push().
+void perf_summarize(const perf_ring *r, perf_stats *out) {
+    memset(out, 0, sizeof(*out));
+    if (r->count == 0) return;
+
+    double frame = 0, step = 0, render = 0;
+    uint64_t steps = 0, idle = 0;
+    uint32_t running = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        const perf_sample *s = &r->samples[i];
+        frame += s->frame_ms;
+        step += s->step_ms;
+        render += s->render_ms;
+        steps += s->steps;
+        idle += s->idle;
+        if (s->steps) running++;
+        out->frame_hist[hist_bucket(s->frame_ms)]++;
+        out->render_hist[hist_bucket(s->render_ms)]++;
+    }
+    out->frame_ms = frame / r->count;
+    out->step_ms = step / r->count;
+    out->render_ms = render / r->count;
+    if (frame > 0) {
+        out->ips = (double) steps * 1000.0 / frame;
+        out->speed = ((double) running / 60.0) / (frame / 1000.0);
+    }
+    if (steps > 0) out->idle_pct = 100.0 * (double) idle / (double) steps;
+}
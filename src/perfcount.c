@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <perfcount.h>
+
+static const char *counter_names[COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "branch-misses",
+    "L1d-misses",
+    "LLC-misses",
+};
+
+const char *counter_name(counter_id id) {
+    return counter_names[id];
+}
+
+bool counter_available(const perf_counters *pc, counter_id id) {
+    return pc->fd[id] >= 0;
+}
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // counters are opened individually so a missing one (common in VMs) doesn't take the rest down
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// open whatever counters the kernel and PMU allow. returns false if none are usable
+// (no PMU, perf_event_paranoid too strict, ...), in which case the caller reports timings only.
+bool counters_open(perf_counters *pc) {
+    memset(pc, 0, sizeof(*pc));
+    pc->fd[COUNTER_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    pc->fd[COUNTER_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    pc->fd[COUNTER_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    pc->fd[COUNTER_L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    pc->fd[COUNTER_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+    bool any = false;
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (pc->fd[i] >= 0) {
+            any = true;
+        } else {
+            fprintf(stderr, "[!] hardware counter %s unavailable\n", counter_names[i]);
+        }
+    }
+    return any;
+}
+
+void counters_start(perf_counters *pc) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (pc->fd[i] < 0) continue;
+        ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void counters_stop(perf_counters *pc) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (pc->fd[i] < 0) continue;
+        ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(pc->fd[i], &pc->value[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+            pc->value[i] = 0;
+        }
+    }
+}
+
+void counters_close(perf_counters *pc) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (pc->fd[i] >= 0) close(pc->fd[i]);
+        pc->fd[i] = -1;
+    }
+}
+#else
+bool counters_open(perf_counters *pc) {
+    memset(pc, 0, sizeof(*pc));
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        pc->fd[i] = -1;
+    }
+    fprintf(stderr, "[!] hardware counters are only supported on linux\n");
+    return false;
+}
+
+void counters_start(perf_counters *pc) {
+}
+
+void counters_stop(perf_counters *pc) {
+}
+
+void counters_close(perf_counters *pc) {
+}
+#endif
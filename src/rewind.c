@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <rewind.h>
+#include <cpu.h>
+
+// reverse execution: periodic checkpoints of the whole machine plus a log of
+// every frame boundary. any earlier cycle is reached by restoring the checkpoint
+// before it and re-executing forward, which is deterministic because input,
+// timers and the random generator are all either logged or part of chip_8.
+
+bool rewind_init(rewind_log *r, size_t budget) {
+    memset(r, 0, sizeof(*r));
+    r->budget = budget;
+    r->frame_capacity = 4096;
+    r->frames = malloc(r->frame_capacity * sizeof(frame_record));
+    r->checkpoint_capacity = 16;
+    r->checkpoints = malloc(r->checkpoint_capacity * sizeof(checkpoint));
+    if (!r->frames || !r->checkpoints) {
+        fprintf(stderr, "[!] failed to allocate the rewind log\n");
+        rewind_free(r);
+        return false;
+    }
+    return true;
+}
+
+void rewind_free(rewind_log *r) {
+    free(r->frames);
+    free(r->checkpoints);
+    memset(r, 0, sizeof(*r));
+}
+
+// bytes allocated for checkpoints and the input log
+size_t rewind_memory(const rewind_log *r) {
+    return r->checkpoint_capacity * sizeof(checkpoint) + r->frame_capacity * sizeof(frame_record);
+}
+
+// a position in the frame log: `done` instructions into repetition `rep` of record `frame`
+typedef struct {
+    uint32_t frame;
+    uint32_t rep;
+    uint32_t done;
+} log_pos;
+
+typedef bool (*replay_visit)(const chip_8 *c, void *ctx);
+
+static void merge_summary(segment_summary *into, const segment_summary *from) {
+    for (int i = 0; i < MEMORY_SIZE / 64; i++) {
+        into->pcs[i] |= from->pcs[i];
+    }
+    into->pages |= from->pages;
+}
+
+// keep every other checkpoint (always the first) and double the spacing. each kept
+// checkpoint's segment now also covers the one after it.
+static void thin_out(rewind_log *r) {
+    int kept = 1;
+    for (int i = 2; i < r->checkpoint_count; i += 2) {
+        merge_summary(&r->checkpoints[kept - 1].after, &r->checkpoints[i - 1].after);
+        r->checkpoints[kept++] = r->checkpoints[i];
+    }
+    if (r->checkpoint_count % 2 == 0) {
+        merge_summary(&r->checkpoints[kept - 1].after, &r->checkpoints[r->checkpoint_count - 1].after);
+    }
+    r->checkpoint_count = kept;
+    r->interval *= 2;
+}
+
+// pages holding any of [lo, hi)
+static uint16_t pages_of(uint16_t lo, uint16_t hi) {
+    if (hi > MEMORY_SIZE) hi = MEMORY_SIZE;
+    if (lo >= hi) return 0;
+    int first = lo / MEMORY_PAGE, last = (hi - 1) / MEMORY_PAGE;
+    return (uint16_t) (((2u << last) - 1) & ~((1u << first) - 1));
+}
+
+static void replay(const rewind_log *r, int k, uint64_t until, chip_8 *c, replay_visit visit, void *ctx,
+                   log_pos *pos);
+
+static bool visit_summary(const chip_8 *c, void *ctx) {
+    segment_summary *s = ctx;
+    if (c->pc < MEMORY_SIZE) s->pcs[c->pc / 64] |= 1ull << (c->pc % 64);
+    uint16_t lo, hi;
+    if (debug_write_span(opcode_at(c, c->pc), c->I, &lo, &hi)) s->pages |= pages_of(lo, hi);
+    return false;
+}
+
+// summarise the last checkpoint's segment, which ends where `c` is now. it is
+// re-executed one step at a time, once, so searches can skip it later.
+static void close_segment(rewind_log *r, const chip_8 *c) {
+    static chip_8 scratch;
+    checkpoint *cp = &r->checkpoints[r->checkpoint_count - 1];
+    log_pos pos;
+    memset(&cp->after, 0, sizeof(cp->after));
+    replay(r, r->checkpoint_count - 1, c->cycles, &scratch, visit_summary, &cp->after, &pos);
+}
+
+static void add_checkpoint(rewind_log *r, const chip_8 *c) {
+    if (r->checkpoint_count) close_segment(r, c);
+    // the input log only grows, so whatever it leaves of the budget goes to checkpoints.
+    // when they don't fit, thin them out: memory stays bounded and re-execution from
+    // the nearest checkpoint stays at most `interval` instructions.
+    size_t frames = r->frame_capacity * sizeof(frame_record);
+    int max = r->budget > frames ? (int) ((r->budget - frames) / sizeof(checkpoint)) : 0;
+    if (max < 4) max = 4;
+    if (r->checkpoint_count == r->checkpoint_capacity && r->checkpoint_capacity * 2 <= max) {
+        checkpoint *grown = realloc(r->checkpoints, r->checkpoint_capacity * 2 * sizeof(checkpoint));
+        if (grown) {
+            r->checkpoints = grown;
+            r->checkpoint_capacity *= 2;
+        }
+    }
+    while (r->checkpoint_count >= max || r->checkpoint_count == r->checkpoint_capacity) {
+        thin_out(r);
+    }
+    if (r->checkpoint_capacity > max && r->checkpoint_count < max) {
+        checkpoint *shrunk = realloc(r->checkpoints, max * sizeof(checkpoint));
+        if (shrunk) {
+            r->checkpoints = shrunk;
+            r->checkpoint_capacity = max;
+        }
+    }
+    checkpoint *cp = &r->checkpoints[r->checkpoint_count++];
+    cp->state = *c;
+    cp->frame = r->frame_count;
+    r->next_checkpoint = c->cycles + r->interval;
+}
+
+// start a new history at the machine's current state (after load or restart)
+void rewind_reset(rewind_log *r, const chip_8 *c) {
+    r->checkpoint_count = 0;
+    r->frame_count = 0;
+    r->interval = REWIND_INTERVAL;
+    add_checkpoint(r, c);
+    // the first record covers anything executed before the first real frame boundary
+    r->frames[0] = (frame_record) {c->keycur, 0, 0, 1};
+    r->frame_count = 1;
+}
+
+// forget the older half of the history: everything before the middle checkpoint.
+// the record just before it stays as an anchor for positions at that checkpoint.
+static void drop_oldest(rewind_log *r) {
+    int k = r->checkpoint_count / 2;
+    uint32_t base = r->checkpoints[k].frame - 1;
+    memmove(r->frames, r->frames + base, (r->frame_count - base) * sizeof(frame_record));
+    r->frame_count -= base;
+    r->frames[0].repeat = 1;
+    memmove(r->checkpoints, r->checkpoints + k, (r->checkpoint_count - k) * sizeof(checkpoint));
+    r->checkpoint_count -= k;
+    for (int i = 0; i < r->checkpoint_count; i++) {
+        r->checkpoints[i].frame -= base;
+    }
+}
+
+static bool append_record(rewind_log *r, const chip_8 *c, frame_record fr) {
+    // input that changes every frame defeats the run-length encoding; once the log
+    // would take more than half the budget, give up the oldest history instead
+    if (r->frame_count == r->frame_capacity && r->checkpoint_count > 1 &&
+        r->frame_capacity * 2 * sizeof(frame_record) > r->budget / 2) {
+        drop_oldest(r);
+    }
+    if (r->frame_count == r->frame_capacity) {
+        frame_record *grown = realloc(r->frames, r->frame_capacity * 2 * sizeof(frame_record));
+        if (!grown) {
+            fprintf(stderr, "[!] rewind log is full, dropping history\n");
+            rewind_reset(r, c);
+            return false;
+        }
+        r->frames = grown;
+        r->frame_capacity *= 2;
+    }
+    r->frames[r->frame_count++] = fr;
+    return true;
+}
+
+static bool same_frame(const frame_record *a, const frame_record *b) {
+    return a->keys == b->keys && a->steps == b->steps && a->boundary == b->boundary;
+}
+
+// fold the just-finished frame into the run before it, unless a checkpoint starts at it
+static void merge_last(rewind_log *r) {
+    uint32_t n = r->frame_count;
+    if (n < 2 || r->checkpoints[r->checkpoint_count - 1].frame == n - 1) return;
+    frame_record *prev = &r->frames[n - 2];
+    frame_record *last = &r->frames[n - 1];
+    if (last->repeat == 1 && same_frame(prev, last)) {
+        prev->repeat++;
+        r->frame_count--;
+    }
+}
+
+// record and apply a frame boundary; replaces begin_frame() while recording
+void rewind_begin_frame(rewind_log *r, chip_8 *c, uint16_t keys) {
+    if (r->frame_count == 0) rewind_reset(r, c);
+    merge_last(r);
+    if (c->cycles >= r->next_checkpoint) add_checkpoint(r, c);
+    append_record(r, c, (frame_record) {keys, 0, 1, 1});
+    begin_frame(c, keys);
+}
+
+// account for instructions executed since the last boundary (batches, single steps)
+void rewind_add_steps(rewind_log *r, chip_8 *c, int steps) {
+    if (r->frame_count == 0) return;
+    while (steps > 0) {
+        frame_record *fr = &r->frames[r->frame_count - 1];
+        if (fr->repeat > 1) {
+            // the current frame is the tail of a run; give it a record of its own
+            fr->repeat--;
+            if (!append_record(r, c, (frame_record) {fr->keys, fr->steps, fr->boundary, 1})) return;
+            continue;
+        }
+        int room = FRAME_MAX_STEPS - fr->steps;
+        if (room == 0) {
+            if (!append_record(r, c, (frame_record) {fr->keys, 0, 0, 1})) return;
+            continue;
+        }
+        int n = steps < room ? steps : room;
+        fr->steps += n;
+        steps -= n;
+    }
+}
+
+// record and apply a change of keys in the middle of a frame; replaces set_keys()
+// while recording
+void rewind_key_event(rewind_log *r, chip_8 *c, uint16_t keys) {
+    if (r->frame_count == 0) rewind_reset(r, c);
+    // keys first: if the log has to start over, it starts from the new keys
+    set_keys(c, keys);
+    append_record(r, c, (frame_record) {keys, 0, 0, 1});
+}
+
+// index of the last checkpoint at or before `cycle`
+static int checkpoint_before(const rewind_log *r, uint64_t cycle) {
+    int lo = 0, hi = r->checkpoint_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (r->checkpoints[mid].state.cycles <= cycle) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// re-execute from checkpoint k up to (not including) instruction `until`, calling
+// visit before each instruction. stops early if visit returns true. on return *c
+// holds the state right before instruction min(until, stop point), and *pos says
+// how much of the frame log that state covers.
+static void replay(const rewind_log *r, int k, uint64_t until, chip_8 *c, replay_visit visit, void *ctx,
+                   log_pos *pos) {
+    const checkpoint *cp = &r->checkpoints[k];
+    *c = cp->state;
+    if (cp->frame) {
+        const frame_record *prev = &r->frames[cp->frame - 1];
+        *pos = (log_pos) {cp->frame - 1, prev->repeat - 1, prev->steps};
+    } else {
+        *pos = (log_pos) {0, 0, 0};
+    }
+    for (uint32_t f = cp->frame; f < r->frame_count; f++) {
+        const frame_record *fr = &r->frames[f];
+        for (uint32_t rep = 0; rep < fr->repeat; rep++) {
+            if (fr->boundary) {
+                // the target sits exactly on this boundary: stop before applying it
+                if (c->cycles >= until) return;
+                begin_frame(c, fr->keys);
+            } else if (fr->keys != c->keycur) {
+                // the same for a key event
+                if (c->cycles >= until) return;
+                set_keys(c, fr->keys);
+            }
+            pos->frame = f;
+            pos->rep = rep;
+            for (uint32_t i = 0; i < fr->steps; i++) {
+                pos->done = i;
+                if (c->cycles >= until) return;
+                if (visit && visit(c, ctx)) return;
+                step(c);
+            }
+            pos->done = fr->steps;
+        }
+    }
+}
+
+// drop history after `pos` so new frames append from there
+static void truncate_at(rewind_log *r, const chip_8 *c, log_pos pos) {
+    frame_record *fr = &r->frames[pos.frame];
+    r->frame_count = pos.frame + 1;
+    if (pos.done == fr->steps) {
+        fr->repeat = pos.rep + 1;
+    } else if (pos.rep == 0) {
+        fr->repeat = 1;
+        fr->steps = pos.done;
+    } else {
+        // earlier repetitions were complete, the current one stops part way
+        fr->repeat = pos.rep;
+        append_record(r, c, (frame_record) {fr->keys, pos.done, fr->boundary, 1});
+    }
+    while (r->checkpoint_count > 1 && r->checkpoints[r->checkpoint_count - 1].frame > pos.frame) {
+        r->checkpoint_count--;
+    }
+}
+
+// move the machine back to the state right before instruction `cycle` executed
+bool rewind_seek(rewind_log *r, chip_8 *c, uint64_t cycle) {
+    if (r->checkpoint_count == 0 || cycle >= c->cycles || cycle < r->checkpoints[0].state.cycles) return false;
+    bool running = c->running;
+    log_pos pos;
+    replay(r, checkpoint_before(r, cycle), cycle, c, NULL, NULL, &pos);
+    truncate_at(r, c, pos);
+    c->running = running;
+    r->next_checkpoint = r->checkpoints[r->checkpoint_count - 1].state.cycles + r->interval;
+    return true;
+}
+
+bool rewind_step_back(rewind_log *r, chip_8 *c) {
+    return c->cycles > 0 && rewind_seek(r, c, c->cycles - 1);
+}
+
+typedef struct {
+    const debugger *d;
+    uint64_t found;
+    bool any;
+} back_search;
+
+static bool visit_stop(const chip_8 *c, void *ctx) {
+    back_search *s = ctx;
+    bool stop = debug_match_before(s->d, c) != HIT_NONE;
+    if (!stop && s->d->watch_count) {
+        uint16_t op = opcode_at(c, c->pc);
+        uint16_t lo, hi;
+        stop = debug_write_span(op, c->I, &lo, &hi) && debug_match_write(s->d, lo, hi) >= 0;
+    }
+    if (stop) {
+        s->found = c->cycles;
+        s->any = true;
+    }
+    return false;
+}
+
+// could anything in the segment after checkpoint k stop the debugger? only the last
+// segment, still being recorded, has no summary to say no.
+static bool may_stop(const rewind_log *r, int k, const debugger *d) {
+    if (k == r->checkpoint_count - 1) return true;
+    const segment_summary *s = &r->checkpoints[k].after;
+    for (int i = 0; i < MEMORY_SIZE / 64; i++) {
+        if (s->pcs[i] & d->breakpoints[i]) return true;
+    }
+    for (int i = 0; i < d->condition_count; i++) {
+        uint16_t pc = d->conditions[i].pc;
+        if (pc == ANY_PC || (pc < MEMORY_SIZE && (s->pcs[pc / 64] >> (pc % 64) & 1))) return true;
+    }
+    for (int i = 0; i < d->watch_count; i++) {
+        if (s->pages & pages_of(d->watches[i].start, d->watches[i].end)) return true;
+    }
+    return false;
+}
+
+// run backwards to the most recent instruction that would have stopped the debugger:
+// a breakpoint, a true condition, or a write to a watched range. segments between
+// checkpoints are searched newest first, and only re-executed if their summary says
+// they could hold a hit, so the cost is bounded by the segments that could.
+bool rewind_continue_back(rewind_log *r, chip_8 *c, debugger *d) {
+    if (r->checkpoint_count == 0 || c->cycles == 0) return false;
+    static chip_8 scratch;
+    uint64_t end = c->cycles;
+    log_pos pos;
+    for (int k = checkpoint_before(r, end); k >= 0; k--) {
+        back_search s = {d, 0, false};
+        if (may_stop(r, k, d)) replay(r, k, end, &scratch, visit_stop, &s, &pos);
+        if (s.any) {
+            rewind_seek(r, c, s.found);
+            d->hit = debug_match_before(d, c);
+            if (d->hit == HIT_NONE) d->hit = HIT_WATCHPOINT;
+            d->hit_pc = c->pc;
+            return true;
+        }
+        end = r->checkpoints[k].state.cycles;
+    }
+    return false;
+}
+
+typedef struct {
+    uint16_t start, end;
+    uint64_t cycle;
+    uint16_t pc;
+    bool any;
+} write_search;
+
+static bool visit_write(const chip_8 *c, void *ctx) {
+    write_search *s = ctx;
+    uint16_t op = opcode_at(c, c->pc);
+    uint16_t lo, hi;
+    if (debug_write_span(op, c->I, &lo, &hi) && lo < s->end && s->start < hi) {
+        s->cycle = c->cycles;
+        s->pc = c->pc;
+        s->any = true;
+    }
+    return false;
+}
+
+// find the last instruction before the current one that wrote anywhere in [start, end),
+// re-executing only segments that wrote a page in that range. the machine itself is
+// left untouched.
+bool rewind_last_write(rewind_log *r, const chip_8 *c, uint16_t start, uint16_t end, uint64_t *cycle, uint16_t *pc) {
+    if (r->checkpoint_count == 0) return false;
+    static chip_8 scratch;
+    uint64_t until = c->cycles;
+    log_pos pos;
+    for (int k = checkpoint_before(r, until); k >= 0; k--) {
+        write_search s = {start, end, 0, 0, false};
+        bool closed = k < r->checkpoint_count - 1;
+        if (!closed || (r->checkpoints[k].after.pages & pages_of(start, end))) {
+            replay(r, k, until, &scratch, visit_write, &s, &pos);
+        }
+        if (s.any) {
+            *cycle = s.cycle;
+            *pc = s.pc;
+            return true;
+        }
+        until = r->checkpoints[k].state.cycles;
+    }
+    return false;
+}
@@ -0,0 +1,15 @@
+#include <stddef.h>
+#include <runahead.h>
+#include <cpu.h>
+
+// the machine to present this frame: `live` itself when run-ahead is off or the live
+// machine is stopped (paused, trapped, single-stepping), otherwise the speculated copy
+const chip_8 *run_ahead_frame(run_ahead *ra, const chip_8 *live, uint16_t keys, int steps_per_frame) {
+    if (ra->frames <= 0 || !live->running) return live;
+    ra->ahead = *live;
+    for (int f = 0; f < ra->frames && ra->ahead.running; f++) {
+        begin_frame(&ra->ahead, keys);
+        run_steps(&ra->ahead, steps_per_frame, NULL, NULL);
+    }
+    return &ra->ahead;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string.h>
+#include <sha1.h>
+
+// plain FIPS 180-1; ROMs are at most a few KiB so there's no streaming interface
+
+static uint32_t rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const uint8_t *block) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t t = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void sha1(const uint8_t *data, size_t size, uint8_t out[SHA1_SIZE]) {
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    size_t full = size / 64 * 64;
+    for (size_t i = 0; i < full; i += 64) {
+        sha1_block(h, data + i);
+    }
+    // the tail: remaining bytes, 0x80, zero padding, then the length in bits
+    uint8_t tail[128] = {0};
+    size_t rest = size - full;
+    memcpy(tail, data + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_size = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t) size * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_size - 1 - i] = (uint8_t) (bits >> (i * 8));
+    }
+    for (size_t i = 0; i < tail_size; i += 64) {
+        sha1_block(h, tail + i);
+    }
+    for (int i = 0; i < 5; i++) {
+        out[i * 4] = h[i] >> 24;
+        out[i * 4 + 1] = h[i] >> 16;
+        out[i * 4 + 2] = h[i] >> 8;
+        out[i * 4 + 3] = h[i];
+    }
+}
+
+void sha1_hex(const uint8_t digest[SHA1_SIZE], char out[SHA1_HEX_SIZE]) {
+    for (int i = 0; i < SHA1_SIZE; i++) {
+        snprintf(out + i * 2, 3, "%02x", digest[i]);
+    }
+}
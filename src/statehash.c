@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <statehash.h>
+
+uint64_t zobrist_addr[MEMORY_SIZE];
+uint64_t zobrist_pixels[SCREEN_WIDTH][SCREEN_HEIGHT];
+
+static uint64_t splitmix(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// fixed seed: hashes are compared across processes and runs
+__attribute__((constructor)) static void zobrist_init(void) {
+    uint64_t state = 0x632be59bd9b4e019ull;
+    for (int i = 0; i < MEMORY_SIZE; i++) {
+        zobrist_addr[i] = splitmix(&state);
+    }
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            zobrist_pixels[x][y] = splitmix(&state);
+        }
+    }
+}
+
+uint64_t memory_hash_full(const chip_8 *c) {
+    uint64_t h = 0;
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        h += zobrist_addr[addr] * c->memory[addr];
+    }
+    return h;
+}
+
+uint64_t display_hash_full(const chip_8 *c) {
+    uint64_t h = 0;
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            if (c->display[x][y]) h ^= zobrist_pixels[x][y];
+        }
+    }
+    return h;
+}
+
+static inline uint64_t mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0xff51afd7ed558ccdull;
+    return h ^ (h >> 32);
+}
+
+// everything that decides what the machine does next except the keypad latches: the
+// incremental memory and display hashes plus the registers, which are few enough to
+// fold in on every call. the instruction count and host-only fields (watchdog, trap
+// details) don't count, so the same state reached at different times hashes the same.
+uint64_t program_hash(const chip_8 *c) {
+#ifdef ORCA_VERIFY_HASH
+    if (c->memory_hash != memory_hash_full(c) || c->display_hash != display_hash_full(c)) {
+        fprintf(stderr, "[!] incremental state hash is stale at %03X after %llu instructions\n", c->pc,
+                (unsigned long long) c->cycles);
+        abort();
+    }
+#endif
+    uint64_t h = c->memory_hash ^ c->display_hash;
+    h = mix(h, (uint64_t) c->running | (uint64_t) c->trap << 8 | (uint64_t) c->profile << 16);
+    h = mix(h, c->pc | (uint64_t) c->I << 16 | (uint64_t) c->sp << 32 | (uint64_t) c->delay_timer << 40 |
+               (uint64_t) c->sound_timer << 48);
+    for (int i = 0; i < 16; i += 8) {
+        uint64_t v = 0;
+        for (int j = 0; j < 8; j++) v |= (uint64_t) c->V[i + j] << (8 * j);
+        h = mix(h, v);
+    }
+    for (int i = 0; i < STACK_SIZE; i += 4) {
+        h = mix(h, c->stack[i] | (uint64_t) c->stack[i + 1] << 16 | (uint64_t) c->stack[i + 2] << 32 |
+                   (uint64_t) c->stack[i + 3] << 48);
+    }
+    return mix(h, c->rng);
+}
+
+// the program's state plus the keys it has latched
+uint64_t position_hash(const chip_8 *c) {
+    return mix(program_hash(c), (uint64_t) c->keycur | (uint64_t) c->keyold << 16);
+}
+
+// the position and how long it took to get there
+uint64_t machine_hash(const chip_8 *c) {
+    return mix(position_hash(c), c->cycles);
+}
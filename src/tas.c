@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <tas.h>
+#include <cpu.h>
+
+// input movies for tool-assisted play. the greenzone holds the states a movie passes
+// through, each stored as its differences from frame 0: skipped runs of unchanged bytes
+// and literal runs of changed ones. code, font and most data never change, so a state
+// usually takes a few hundred bytes instead of sizeof(chip_8).
+
+static size_t put_varint(uint8_t *out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+static uint32_t get_varint(const uint8_t **p) {
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *(*p)++;
+        v |= (uint32_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+// (skip, count, count literal bytes)... against the origin
+static size_t encode(const chip_8 *c, const chip_8 *origin, uint8_t *out) {
+    const uint8_t *a = (const uint8_t *) c, *b = (const uint8_t *) origin;
+    size_t n = 0, i = 0, size = sizeof(chip_8);
+    while (i < size) {
+        size_t start = i;
+        while (i < size && a[i] == b[i]) i++;
+        if (i == size) break;
+        size_t skip = i - start, lit = i;
+        // a literal run ends at the first stretch of four unchanged bytes
+        while (i < size && (a[i] != b[i] || (i + 4 <= size && memcmp(a + i, b + i, 4)))) i++;
+        n += put_varint(out + n, (uint32_t) skip);
+        n += put_varint(out + n, (uint32_t) (i - lit));
+        memcpy(out + n, a + lit, i - lit);
+        n += i - lit;
+    }
+    return n;
+}
+
+static void decode(const greenzone_state *s, const chip_8 *origin, chip_8 *c) {
+    *c = *origin;
+    uint8_t *a = (uint8_t *) c;
+    const uint8_t *p = s->data, *end = s->data + s->size;
+    size_t i = 0;
+    while (p < end) {
+        i += get_varint(&p);
+        uint32_t count = get_varint(&p);
+        memcpy(a + i, p, count);
+        p += count;
+        i += count;
+    }
+}
+
+bool tas_init(tas_movie *t, const chip_8 *start, int steps_per_frame, size_t budget) {
+    memset(t, 0, sizeof(*t));
+    t->budget = budget;
+    t->interval = TAS_INTERVAL;
+    t->steps_per_frame = steps_per_frame;
+    t->origin = *start;
+    t->now = *start;
+    t->capacity = 4096;
+    t->keys = calloc(t->capacity, sizeof(uint16_t));
+    t->zone_capacity = 256;
+    t->zone = malloc(t->zone_capacity * sizeof(greenzone_state));
+    if (!t->keys || !t->zone) {
+        fprintf(stderr, "[!] failed to allocate the movie\n");
+        tas_free(t);
+        return false;
+    }
+    // frame 0 is the origin itself, with no differences to store
+    t->zone[0] = (greenzone_state) {0, 0, NULL};
+    t->zone_count = 1;
+    return true;
+}
+
+void tas_free(tas_movie *t) {
+    for (int i = 0; i < t->zone_count; i++) {
+        free(t->zone[i].data);
+    }
+    free(t->zone);
+    free(t->keys);
+    memset(t, 0, sizeof(*t));
+}
+
+size_t tas_memory(const tas_movie *t) {
+    return t->capacity * sizeof(uint16_t) + t->zone_capacity * sizeof(greenzone_state) + t->zone_bytes;
+}
+
+uint16_t tas_keys(const tas_movie *t, uint32_t frame) {
+    return frame < t->length ? t->keys[frame] : 0;
+}
+
+// drop every state after `frame`; they were computed from the old input
+static void invalidate_after(tas_movie *t, uint32_t frame) {
+    while (t->zone_count > 1 && t->zone[t->zone_count - 1].frame > frame) {
+        greenzone_state *s = &t->zone[--t->zone_count];
+        t->zone_bytes -= s->size;
+        free(s->data);
+    }
+}
+
+// double the spacing: states off the new grid go, except the ones near the cursor
+static void thin_out(tas_movie *t) {
+    t->interval *= 2;
+    int kept = 1;
+    for (int i = 1; i < t->zone_count; i++) {
+        greenzone_state *s = &t->zone[i];
+        uint32_t distance = s->frame > t->cursor ? s->frame - t->cursor : t->cursor - s->frame;
+        if (s->frame % t->interval == 0 || distance <= TAS_NEAR) {
+            t->zone[kept++] = *s;
+        } else {
+            t->zone_bytes -= s->size;
+            free(s->data);
+        }
+    }
+    t->zone_count = kept;
+}
+
+static void capture(tas_movie *t, const chip_8 *c, uint32_t frame) {
+    static _Thread_local uint8_t scratch[sizeof(chip_8) * 2];
+    while (t->zone_bytes > t->budget && t->interval < (1u << 30)) {
+        thin_out(t);
+    }
+    if (frame % t->interval) return;
+    if (t->zone_count == t->zone_capacity) {
+        greenzone_state *grown = realloc(t->zone, t->zone_capacity * 2 * sizeof(greenzone_state));
+        if (!grown) return;
+        t->zone = grown;
+        t->zone_capacity *= 2;
+    }
+    size_t size = encode(c, &t->origin, scratch);
+    uint8_t *data = malloc(size ? size : 1);
+    if (!data) return;
+    memcpy(data, scratch, size);
+    t->zone[t->zone_count++] = (greenzone_state) {frame, (uint32_t) size, data};
+    t->zone_bytes += size;
+}
+
+static void run_to(tas_movie *t, uint32_t frame) {
+    while (t->cursor < frame) {
+        begin_frame(&t->now, tas_keys(t, t->cursor));
+        run_steps(&t->now, t->steps_per_frame, NULL, NULL);
+        t->cursor++;
+        t->resimulated++;
+        if (t->cursor > t->zone[t->zone_count - 1].frame) capture(t, &t->now, t->cursor);
+    }
+}
+
+// the nearest greenzone state at or before `frame`
+static const greenzone_state *nearest(const tas_movie *t, uint32_t frame) {
+    int lo = 0, hi = t->zone_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (t->zone[mid].frame <= frame) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return &t->zone[lo];
+}
+
+static void reload(tas_movie *t, uint32_t frame) {
+    const greenzone_state *base = nearest(t, frame);
+    decode(base, &t->origin, &t->now);
+    t->cursor = base->frame;
+    run_to(t, frame);
+}
+
+// put `keys` in the movie at `frame`. the machine stays at the cursor, re-simulated
+// if the edit lies before it.
+bool tas_set_keys(tas_movie *t, uint32_t frame, uint16_t keys) {
+    if (frame >= t->length) {
+        if (!keys) return true;
+        if (frame >= t->capacity) {
+            uint32_t capacity = t->capacity;
+            while (capacity <= frame) capacity *= 2;
+            uint16_t *grown = realloc(t->keys, capacity * sizeof(uint16_t));
+            if (!grown) return false;
+            memset(grown + t->capacity, 0, (capacity - t->capacity) * sizeof(uint16_t));
+            t->keys = grown;
+            t->capacity = capacity;
+        }
+        t->length = frame + 1;
+    }
+    if (t->keys[frame] == keys) return true;
+    t->keys[frame] = keys;
+    invalidate_after(t, frame);
+    if (frame < t->cursor) reload(t, t->cursor);
+    return true;
+}
+
+// move the machine to the start of `frame`: forward from where it is if nothing in
+// the greenzone is closer, otherwise from the nearest state before it
+void tas_seek(tas_movie *t, uint32_t frame) {
+    if (frame < t->cursor || nearest(t, frame)->frame > t->cursor) {
+        reload(t, frame);
+    } else {
+        run_to(t, frame);
+    }
+}
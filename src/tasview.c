@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <tasview.h>
+#include <raygui.h>
+
+#define ROW_HEIGHT 14
+#define FRAME_WIDTH 48
+#define FONT_SIZE 10
+
+// clicking a frame number seeks there; clicking a cell toggles that key in that frame.
+// the view scrolls with the wheel and follows the cursor while playing.
+void draw_tas_view(tas_view *v, tas_movie *t, Rectangle bounds) {
+    if (GuiButton((Rectangle) {bounds.x + 4, bounds.y + 28, 24, 24},
+                  GuiIconText(v->playing ? ICON_PLAYER_PAUSE : ICON_PLAYER_PLAY, NULL))) {
+        v->playing = !v->playing;
+    }
+    v->recording = GuiToggle((Rectangle) {bounds.x + 32, bounds.y + 28, 24, 24},
+                             GuiIconText(ICON_PLAYER_RECORD, NULL), v->recording);
+    DrawText(TextFormat("frame %u of %u", t->cursor, t->length), bounds.x + 64, bounds.y + 30, FONT_SIZE, DARKGRAY);
+    DrawText(TextFormat("%d states every %u, %.1f KiB", t->zone_count, t->interval, tas_memory(t) / 1024.0),
+             bounds.x + 64, bounds.y + 42, FONT_SIZE, GRAY);
+
+    Rectangle grid = {bounds.x + 4, bounds.y + 58, bounds.width - 8, TAS_ROWS * ROW_HEIGHT};
+    float key_width = (grid.width - FRAME_WIDTH) / 16;
+    Vector2 mouse = GetMousePosition();
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0 && CheckCollisionPointRec(mouse, grid)) {
+        int64_t top = (int64_t) v->top - (int64_t) wheel * 4;
+        v->top = top < 0 ? 0 : (uint32_t) top;
+    } else if (v->playing && (t->cursor < v->top || t->cursor >= v->top + TAS_ROWS)) {
+        v->top = t->cursor > TAS_ROWS / 2 ? t->cursor - TAS_ROWS / 2 : 0;
+    }
+
+    for (int k = 0; k < 16; k++) {
+        DrawText(TextFormat("%X", k), grid.x + FRAME_WIDTH + k * key_width + key_width / 2 - 3, grid.y - 12,
+                 FONT_SIZE, GRAY);
+    }
+    bool clicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    for (int i = 0; i < TAS_ROWS; i++) {
+        uint32_t frame = v->top + i;
+        Rectangle row = {grid.x, grid.y + i * ROW_HEIGHT, grid.width, ROW_HEIGHT};
+        if (frame == t->cursor) DrawRectangleRec(row, Fade(SKYBLUE, 0.5f));
+        Rectangle label = {row.x, row.y, FRAME_WIDTH, ROW_HEIGHT};
+        // frames before the last greenzone state are a decode plus a few frames away
+        bool green = frame <= t->zone[t->zone_count - 1].frame;
+        DrawText(TextFormat("%u", frame), label.x + 2, label.y + 2, FONT_SIZE, green ? DARKGREEN : DARKGRAY);
+        if (clicked && CheckCollisionPointRec(mouse, label)) tas_seek(t, frame);
+        uint16_t keys = tas_keys(t, frame);
+        for (int k = 0; k < 16; k++) {
+            Rectangle cell = {row.x + FRAME_WIDTH + k * key_width, row.y, key_width, ROW_HEIGHT};
+            if (keys >> k & 1) DrawRectangleRec((Rectangle) {cell.x + 2, cell.y + 2, cell.width - 4, cell.height - 4}, MAROON);
+            DrawRectangleLinesEx(cell, 1, Fade(LIGHTGRAY, 0.5f));
+            if (clicked && CheckCollisionPointRec(mouse, cell)) tas_set_keys(t, frame, keys ^ (1 << k));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <trace.h>
+#include <perf.h>
+
+typedef struct {
+    const char *name;
+    double ts;
+    char phase; // 'B' or 'E', as in the chrome trace format
+} trace_event;
+
+typedef struct trace_buffer {
+    trace_event events[TRACE_EVENTS_PER_THREAD];
+    uint32_t count;
+    uint32_t tid;
+    const char *thread_name;
+    bool exited; // kept for the dump, freed by the next trace_start()
+    struct trace_buffer *next;
+} trace_buffer;
+
+volatile bool trace_enabled = false;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_buffer *trace_buffers = NULL;
+static uint32_t trace_next_tid = 1;
+static double trace_epoch = 0;
+static _Thread_local trace_buffer *local_buffer = NULL;
+static _Thread_local const char *local_name = NULL;
+static pthread_key_t trace_exit_key;
+static pthread_once_t trace_exit_once = PTHREAD_ONCE_INIT;
+
+// a thread's buffer outlives it only if it holds events the next dump may want
+static void thread_exit(void *arg) {
+    trace_buffer *b = arg;
+    pthread_mutex_lock(&trace_lock);
+    if (b->count) {
+        b->exited = true;
+    } else {
+        for (trace_buffer **p = &trace_buffers; *p; p = &(*p)->next) {
+            if (*p == b) {
+                *p = b->next;
+                free(b);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void make_exit_key(void) {
+    pthread_key_create(&trace_exit_key, thread_exit);
+}
+
+// every thread that records gets its own buffer on first use, so recording never takes
+// a lock. threads that never record while tracing is on never get one.
+static trace_buffer *thread_buffer(void) {
+    if (local_buffer) return local_buffer;
+    trace_buffer *b = calloc(1, sizeof(trace_buffer));
+    if (!b) return NULL;
+    b->thread_name = local_name;
+    pthread_once(&trace_exit_once, make_exit_key);
+    pthread_mutex_lock(&trace_lock);
+    b->tid = trace_next_tid++;
+    b->next = trace_buffers;
+    trace_buffers = b;
+    pthread_mutex_unlock(&trace_lock);
+    pthread_setspecific(trace_exit_key, b);
+    local_buffer = b;
+    return b;
+}
+
+static void trace_record(const char *name, char phase) {
+    trace_buffer *b = thread_buffer();
+    if (!b || b->count >= TRACE_EVENTS_PER_THREAD) return;
+    trace_event *e = &b->events[b->count];
+    e->name = name;
+    e->ts = perf_now();
+    e->phase = phase;
+    b->count++;
+}
+
+void trace_begin(const char *name) {
+    trace_record(name, 'B');
+}
+
+void trace_end(const char *name) {
+    trace_record(name, 'E');
+}
+
+// the name is kept until the thread records something, so naming allocates nothing
+void trace_set_thread_name(const char *name) {
+    local_name = name;
+    if (local_buffer) local_buffer->thread_name = name;
+}
+
+// drop everything recorded so far, and the buffers of threads that have exited, and
+// start a new capture
+void trace_start(void) {
+    pthread_mutex_lock(&trace_lock);
+    for (trace_buffer **p = &trace_buffers; *p;) {
+        trace_buffer *b = *p;
+        if (b->exited) {
+            *p = b->next;
+            free(b);
+        } else {
+            b->count = 0;
+            p = &b->next;
+        }
+    }
+    trace_epoch = perf_now();
+    pthread_mutex_unlock(&trace_lock);
+    trace_enabled = true;
+    printf("[*] tracing started\n");
+}
+
+void trace_stop(void) {
+    trace_enabled = false;
+    printf("[*] tracing stopped\n");
+}
+
+// write all per-thread buffers as chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// call after trace_stop(), writers aren't synchronised with the dump.
+bool trace_dump(const char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "[!] failed to open trace file %s\n", filename);
+        return false;
+    }
+    fprintf(fp, "{\"traceEvents\":[\n");
+    bool first = true;
+    pthread_mutex_lock(&trace_lock);
+    for (trace_buffer *b = trace_buffers; b; b = b->next) {
+        if (b->thread_name) {
+            fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", b->tid, b->thread_name);
+            first = false;
+        }
+        for (uint32_t i = 0; i < b->count; i++) {
+            trace_event *e = &b->events[i];
+            fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                    first ? "" : ",\n", e->name, e->phase, (e->ts - trace_epoch) * 1e6, b->tid);
+            first = false;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    printf("[*] wrote trace to %s\n", filename);
+    return true;
+}